@@ -0,0 +1,373 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/* Copyright (C) 2024 Eric Herman <eric@freesa.org> */
+
+/* for sched_setaffinity */
+#define _GNU_SOURCE
+
+#include "uuid7.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+#include <unistd.h>
+
+/* the Makefile names the build, e.g. "static" or "dynamic" */
+#ifndef UUID7_BENCH_LABEL
+#define UUID7_BENCH_LABEL "static"
+#endif
+
+#if defined(UUID7_WITH_MUTEX)
+#define UUID7_BENCH_STATE "mutex"
+#elif defined(UUID7_WITH_ATOMIC)
+#define UUID7_BENCH_STATE "atomic"
+#elif defined(UUID7_PER_CPU)
+#define UUID7_BENCH_STATE "per-cpu"
+#elif defined(UUID7_NO_THREADS)
+#define UUID7_BENCH_STATE "no-threads"
+#else
+#define UUID7_BENCH_STATE "thread_local"
+#endif
+
+void err(const char *file, long line, const char *func, int err, char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	fprintf(stderr, "%s:%ld %s(): ", file, line, func);
+	if (err) {
+		fprintf(stderr, "%s: ", strerror(err));
+	}
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+}
+
+#define Die(...) do { \
+	err(__FILE__, __LINE__, __func__, errno, __VA_ARGS__); \
+	exit(EXIT_FAILURE); \
+} while (0)
+
+struct bench_ctx {
+	uint8_t ubuf[16];
+	char str[40];
+	struct uuid7 parts;
+	struct uuid7_gen *gen;
+	uint32_t sink;
+};
+
+typedef int (*bench_fn)(struct bench_ctx *ctx);
+
+/* the cost of the loop and of the timer, to read the others against */
+static int bench_noop(struct bench_ctx *ctx)
+{
+	++ctx->sink;
+	return 1;
+}
+
+static int bench_uuid7(struct bench_ctx *ctx)
+{
+	return uuid7(ctx->ubuf) != NULL;
+}
+
+/* the generators of the threads are side by side in one array */
+static int bench_gen_next(struct bench_ctx *ctx)
+{
+	return uuid7_gen_next(ctx->gen, ctx->ubuf) != NULL;
+}
+
+static int bench_to_string(struct bench_ctx *ctx)
+{
+	uuid7_to_string(ctx->str, sizeof(ctx->str), ctx->ubuf);
+	ctx->sink += ctx->str[35];
+	return 1;
+}
+
+static int bench_to_base32(struct bench_ctx *ctx)
+{
+	uuid7_to_base32(ctx->str, sizeof(ctx->str), ctx->ubuf);
+	ctx->sink += ctx->str[25];
+	return 1;
+}
+
+static int bench_to_base64url(struct bench_ctx *ctx)
+{
+	uuid7_to_base64url(ctx->str, sizeof(ctx->str), ctx->ubuf);
+	ctx->sink += ctx->str[21];
+	return 1;
+}
+
+static int bench_hash64(struct bench_ctx *ctx)
+{
+	ctx->sink += (uint32_t)uuid7_hash64(ctx->ubuf);
+	return 1;
+}
+
+static int bench_parts(struct bench_ctx *ctx)
+{
+	int ok = uuid7_parts(&ctx->parts, ctx->ubuf) != NULL;
+	ctx->sink += ctx->parts.rand;
+	return ok;
+}
+
+#ifndef UUID7_NO_THREADS
+/* a failure is a take from an empty ring, the producer fell behind */
+static struct uuid7_ring *bench_ring;
+static int bench_take(struct bench_ctx *ctx)
+{
+	return uuid7_take(bench_ring, ctx->ubuf) != NULL;
+}
+#endif
+
+struct bench_op {
+	const char *name;
+	bench_fn fn;
+};
+
+static const struct bench_op bench_ops[] = {
+	{ "noop", bench_noop },
+	{ "uuid7", bench_uuid7 },
+	{ "uuid7_gen_next", bench_gen_next },
+	{ "uuid7_to_string", bench_to_string },
+	{ "uuid7_to_base32", bench_to_base32 },
+	{ "uuid7_to_base64url", bench_to_base64url },
+	{ "uuid7_parts", bench_parts },
+	{ "uuid7_hash64", bench_hash64 },
+#ifndef UUID7_NO_THREADS
+	{ "uuid7_take", bench_take },
+#endif
+};
+
+struct bench_task {
+	bench_fn fn;
+	size_t iterations;
+	size_t warmup;
+	int cpu;
+	size_t num_threads;
+	struct uuid7_gen *gen;
+	atomic_size_t *ready;
+	uint64_t *samples;
+	uint64_t elapsed_ns;
+	size_t failures;
+	uint32_t sink;
+};
+
+static uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (((uint64_t)ts.tv_sec) * 1000000000) + ts.tv_nsec;
+}
+
+static void bench_pin(int cpu)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	/* pid 0 is the calling thread; failure only makes it noisier */
+	sched_setaffinity(0, sizeof(set), &set);
+}
+
+static int bench_thread_func(void *context)
+{
+	struct bench_task *task = (struct bench_task *)context;
+	struct bench_ctx ctx;
+	memset(&ctx, 0x00, sizeof(ctx));
+	ctx.gen = task->gen;
+
+	bench_pin(task->cpu);
+	if (!uuid7(ctx.ubuf)) {
+		++task->failures;
+	}
+
+	for (size_t i = 0; i < task->warmup; ++i) {
+		task->fn(&ctx);
+	}
+
+	/* start together, so that the threads contend */
+	atomic_fetch_add(task->ready, 1);
+	while (atomic_load(task->ready) < task->num_threads) {
+		thrd_yield();
+	}
+
+	uint64_t begin = bench_now_ns();
+	for (size_t i = 0; i < task->iterations; ++i) {
+		if (!task->fn(&ctx)) {
+			++task->failures;
+		}
+	}
+	task->elapsed_ns = bench_now_ns() - begin;
+
+	for (size_t i = 0; i < task->iterations; ++i) {
+		uint64_t before = bench_now_ns();
+		if (!task->fn(&ctx)) {
+			++task->failures;
+		}
+		task->samples[i] = bench_now_ns() - before;
+	}
+
+	task->sink = ctx.sink;
+	return EXIT_SUCCESS;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const uint64_t *sorted, size_t len, double q)
+{
+	return sorted[(size_t)(q * (len - 1))];
+}
+
+static void bench_run(const struct bench_op *op, size_t num_threads,
+		      size_t iterations, int num_cpus, int json)
+{
+	thrd_t *thread_ids = (thrd_t *) calloc(num_threads, sizeof(thrd_t));
+	struct bench_task *tasks =
+	    (struct bench_task *)calloc(num_threads, sizeof(struct bench_task));
+	size_t samples_len = num_threads * iterations;
+	uint64_t *samples = (uint64_t *)calloc(samples_len, sizeof(uint64_t));
+	size_t gens_size = num_threads * sizeof(struct uuid7_gen);
+	struct uuid7_gen *gens =
+	    (struct uuid7_gen *)aligned_alloc(UUID7_CACHE_LINE, gens_size);
+	size_t entropy_size = 4096;
+	uint8_t *entropy = (uint8_t *)malloc(num_threads * entropy_size);
+	if (!thread_ids || !tasks || !samples || !gens || !entropy) {
+		Die("failed to allocate for %zu threads", num_threads);
+	}
+
+	atomic_size_t ready;
+	atomic_init(&ready, 0);
+	for (size_t i = 0; i < num_threads; ++i) {
+		tasks[i].fn = op->fn;
+		tasks[i].iterations = iterations;
+		tasks[i].warmup = iterations / 10;
+		tasks[i].cpu = (int)(i % (size_t)num_cpus);
+		tasks[i].num_threads = num_threads;
+		uuid7_gen_init(&gens[i], entropy + (i * entropy_size),
+			       entropy_size);
+		tasks[i].gen = &gens[i];
+		tasks[i].ready = &ready;
+		tasks[i].samples = samples + (i * iterations);
+		if (thrd_create(&thread_ids[i], bench_thread_func, &tasks[i])) {
+			Die("thrd_create %zu", i);
+		}
+	}
+
+	uint64_t max_elapsed = 0;
+	long double ns_per_op = 0.0;
+	size_t failures = 0;
+	for (size_t i = 0; i < num_threads; ++i) {
+		thrd_join(thread_ids[i], NULL);
+		if (tasks[i].elapsed_ns > max_elapsed) {
+			max_elapsed = tasks[i].elapsed_ns;
+		}
+		ns_per_op += ((long double)tasks[i].elapsed_ns) / iterations;
+		failures += tasks[i].failures;
+	}
+	ns_per_op = ns_per_op / num_threads;
+	long double ops_per_sec = max_elapsed
+	    ? (((long double)samples_len) * 1000000000.0) / max_elapsed : 0.0;
+
+	qsort(samples, samples_len, sizeof(uint64_t), u64_compare);
+	uint64_t p50 = percentile(samples, samples_len, 0.50);
+	uint64_t p99 = percentile(samples, samples_len, 0.99);
+	uint64_t p999 = percentile(samples, samples_len, 0.999);
+
+	const char *fmt = json
+	    ? "{\"build\":\"%s\",\"state\":\"%s\",\"op\":\"%s\","
+	    "\"threads\":%zu,\"iterations\":%zu,"
+	    "\"ns_per_op\":%.2Lf,\"ops_per_sec\":%.0Lf,"
+	    "\"p50_ns\":%" PRIu64 ",\"p99_ns\":%" PRIu64 ",\"p999_ns\":%"
+	    PRIu64 ",\"failures\":%zu}\n"
+	    : "%s,%s,%s,%zu,%zu,%.2Lf,%.0Lf,%" PRIu64 ",%" PRIu64 ",%" PRIu64
+	    ",%zu\n";
+	printf(fmt, UUID7_BENCH_LABEL, UUID7_BENCH_STATE, op->name,
+	       num_threads, iterations, ns_per_op, ops_per_sec, p50, p99, p999,
+	       failures);
+	fflush(stdout);
+
+	free(entropy);
+	free(gens);
+	free(samples);
+	free(tasks);
+	free(thread_ids);
+}
+
+/* usage: uuid7-bench [max_threads] [iterations] [csv|json] */
+int main(int argc, char **argv)
+{
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	int num_cpus = (online > 0) ? (int)online : 1;
+
+	size_t max_threads = 0;
+	if (argc > 1) {
+		int i = atoi(argv[1]);
+		if (i >= 0) {
+			max_threads = (unsigned)i;
+		}
+	}
+	max_threads = max_threads ? max_threads : (size_t)num_cpus;
+#ifdef UUID7_NO_THREADS
+	max_threads = 1;
+#endif
+
+	size_t iterations = 0;
+	if (argc > 2) {
+		int i = atoi(argv[2]);
+		if (i >= 0) {
+			iterations = (unsigned)i;
+		}
+	}
+	iterations = iterations ? iterations : 100 * 1000;
+
+	int json = (argc > 3) && (strcmp(argv[3], "json") == 0);
+
+#ifdef UUID7_WITH_MUTEX
+	uuid7_mutex_init();
+#endif
+#ifndef UUID7_NO_THREADS
+	bench_ring = uuid7_ring_start(1 << 16, 1 << 15, 100 * 1000 * 1000);
+	if (!bench_ring) {
+		Die("uuid7_ring_start failed");
+	}
+#endif
+
+	if (!json) {
+		/* one sample per call, each including the cost of the timer */
+		printf("build,state,op,threads,iterations,ns_per_op,"
+		       "ops_per_sec,p50_ns,p99_ns,p999_ns,failures\n");
+	}
+	size_t num_ops = sizeof(bench_ops) / sizeof(bench_ops[0]);
+	/* powers of two, and max_threads even if not a power of two */
+	size_t threads = 1;
+	while (threads) {
+		for (size_t i = 0; i < num_ops; ++i) {
+			bench_run(&bench_ops[i], threads, iterations,
+				  num_cpus, json);
+		}
+		if (threads == max_threads) {
+			threads = 0;
+		} else {
+			threads = (threads * 2 > max_threads)
+			    ? max_threads : threads * 2;
+		}
+	}
+
+#ifndef UUID7_NO_THREADS
+	uuid7_ring_stop(bench_ring);
+#endif
+#ifdef UUID7_WITH_MUTEX
+	uuid7_mutex_destroy();
+#endif
+
+	return 0;
+}
@@ -106,8 +106,6 @@ static int clockid_to_fd(clockid_t clk)
 	return ((unsigned int)~((clk) >> 3));
 }
 
-extern const clockid_t uuid7_clockid;
-
 #define elapsed_ts(begin, until) \
 	( (until.tv_sec + (until.tv_nsec / (long double)1000000000.0)) \
 	- (begin.tv_sec + (begin.tv_nsec / (long double)1000000000.0)) )
@@ -169,11 +167,6 @@ int uuid7_task_thread_func(void *context)
 	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
-int memcmp16(const void *a, const void *b)
-{
-	return memcmp(a, b, 16);
-}
-
 static long double per_second(long double quantity, long double elapsed_seconds)
 {
 	return quantity / elapsed_seconds;
@@ -209,9 +202,12 @@ int main(int argc, char **argv)
 			Die("open(\"%s\", O_RDWR)", dev_clock);
 		}
 		clockid = fd_to_clockid(fd);
-	} else {
-		clockid = uuid7_clockid;
+		if (uuid7_set_clock(clockid)) {
+			Die("uuid7_set_clock(%ld)", (long)clockid);
+		}
 	}
+	struct uuid7_clock_info clock_info;
+	clockid = uuid7_get_clock(&clock_info);
 	int clockfd = clockid_to_fd(clockid);
 	if (clockfd >= 0) {
 		printf("clockid fd: %d\n", clockid_to_fd(clockid));
@@ -238,6 +234,11 @@ int main(int argc, char **argv)
 
 	printf("    resolution:  %jd.%09ld\n", (intmax_t) ts[0].tv_sec,
 	       ts[0].tv_nsec);
+	printf("    of %" PRIu64 " reads, %" PRIu64 " duplicates,"
+	       " smallest step %" PRIu64 " ns\n", clock_info.samples,
+	       clock_info.duplicates, clock_info.step_ns);
+	printf("    hiseq bits which change with the clock: %u of 6\n",
+	       clock_info.hiseq_bits);
 
 	struct timespec_task *ts_contexts =
 	    (struct timespec_task *)calloc(num_threads,
@@ -371,9 +372,23 @@ int main(int argc, char **argv)
 	if (max_retries > 0) {
 		printf("\t(max_retries: %zu)\n", max_retries);
 	}
+	struct uuid7_stats stats;
+	uuid7_stats_get(&stats);
+	printf("\t(%" PRIu64 " calls, %" PRIu64 " backwards, %" PRIu64
+	       " sequence overflows, max sequence %" PRIu64 ")\n",
+	       stats.calls, stats.backwards, stats.seq_overflows,
+	       stats.max_seq);
 	free(uuid7_tasks);
 
-	qsort(uuid7s, uuids_len, uuid7_bytes, memcmp16);
+	printf("Sorting %zu UUIDs across %zu threads ...", uuids_len,
+	       num_threads);
+	fflush(stdout);
+	clock_gettime(clockid, &ts_begin);
+	uuid7_sort_parallel(uuid7s, uuids_len, num_threads);
+	clock_gettime(clockid, &ts_final);
+	elapsed = elapsed_ts(ts_begin, ts_final);
+	printf("\n\tdone in %.9LF seconds (~%.9LF each, %.0LF per second).\n",
+	       elapsed, elapsed / uuids_len, per_second(uuids_len, elapsed));
 
 	/* absolute duplicate */
 	size_t same16 = 0;
@@ -450,6 +465,71 @@ int main(int argc, char **argv)
 		printf("%04zu: %s\n", i, buf2);
 	}
 
+	printf("\nFormatting and splitting %zu UUIDs ...", uuids_len);
+	fflush(stdout);
+	size_t not_uuid7 = 0;
+	uint32_t checksum = 0;
+
+	clock_gettime(clockid, &ts_begin);
+	for (size_t i = 0; i < uuids_len; ++i) {
+		char buf3[40];
+		struct uuid7 parts;
+		size_t offset = i * uuid7_bytes;
+		uuid7_to_string(buf3, 40, uuid7s + offset);
+		if (!uuid7_parts(&parts, uuid7s + offset)) {
+			++not_uuid7;
+		}
+		checksum += buf3[35] + parts.rand;
+	}
+	clock_gettime(clockid, &ts_final);
+	elapsed = elapsed_ts(ts_begin, ts_final);
+	percall = (elapsed / uuids_len);
+	printf("\n\tdone in %.9LF seconds (~%.9LF each, %.0LF per second).\n",
+	       elapsed, percall, per_second(uuids_len, elapsed));
+	printf("\t(checksum: %08" PRIx32 ", not version 7: %zu)\n", checksum,
+	       not_uuid7);
+
+	size_t strs_size = uuids_len * 37;
+	char *strs = (char *)calloc(1, strs_size);
+	if (!strs) {
+		Die("failed to allocate %zu bytes", strs_size);
+	}
+	printf("\nFormatting %zu UUIDs as one batch ...", uuids_len);
+	fflush(stdout);
+	clock_gettime(clockid, &ts_begin);
+	if (!uuid7_to_string_n(strs, strs_size, uuid7s, uuids_len, 37)) {
+		Die("uuid7_to_string_n(%p, %zu, %p, %zu, 37)", strs, strs_size,
+		    uuid7s, uuids_len);
+	}
+	clock_gettime(clockid, &ts_final);
+	elapsed = elapsed_ts(ts_begin, ts_final);
+	percall = (elapsed / uuids_len);
+	printf("\n\tdone in %.9LF seconds (~%.9LF each, %.0LF per second).\n",
+	       elapsed, percall, per_second(uuids_len, elapsed));
+	printf("\t(last: %s)\n", strs + ((uuids_len - 1) * 37));
+
+	uint8_t *parsed = (uint8_t *)calloc(1, uuids_size);
+	if (!parsed) {
+		Die("failed to allocate %zu bytes", uuids_size);
+	}
+	printf("\nParsing %zu UUIDs as one batch ...", uuids_len);
+	fflush(stdout);
+	clock_gettime(clockid, &ts_begin);
+	if (!uuid7_from_string_n(parsed, strs, uuids_len, 36, 37)) {
+		Die("uuid7_from_string_n(%p, %p, %zu, 36, 37)", parsed, strs,
+		    uuids_len);
+	}
+	clock_gettime(clockid, &ts_final);
+	elapsed = elapsed_ts(ts_begin, ts_final);
+	percall = (elapsed / uuids_len);
+	printf("\n\tdone in %.9LF seconds (~%.9LF each, %.0LF per second).\n",
+	       elapsed, percall, per_second(uuids_len, elapsed));
+	if (memcmp(parsed, uuid7s, uuids_size)) {
+		Die("parsed UUIDs differ from the originals");
+	}
+	free(parsed);
+	free(strs);
+
 #ifdef UUID7_WITH_MUTEX
 	uuid7_mutex_destroy();
 #endif
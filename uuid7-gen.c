@@ -0,0 +1,508 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/* Copyright (C) 2024 Eric Herman <eric@freesa.org> */
+
+/* for vmsplice and F_GETPIPE_SZ */
+#define _GNU_SOURCE
+
+#include "uuid7.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <threads.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/uio.h>
+#endif
+
+/*
+   Streams count UUIDs to stdout or a file. Each thread has its own
+   generator, and fills chunks of IDs in turn: thread t formats chunks t,
+   t + threads, t + (2 * threads), ... in to two buffers of its own, while
+   the main thread writes the chunks in order. With -m, the file is mapped,
+   and each thread formats its chunks in place, thus nothing is copied.
+   With one thread, the output is sorted; with more, each chunk is sorted.
+*/
+
+#define GEN_FORMAT_HEX 0
+#define GEN_FORMAT_BASE32 1
+#define GEN_FORMAT_BINARY 2
+
+#define GEN_PAGE 4096
+
+void err(const char *file, long line, const char *func, int err, char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	fprintf(stderr, "%s:%ld %s(): ", file, line, func);
+	if (err) {
+		fprintf(stderr, "%s: ", strerror(err));
+	}
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+}
+
+#define Die(...) do { \
+	err(__FILE__, __LINE__, __func__, errno, __VA_ARGS__); \
+	exit(EXIT_FAILURE); \
+} while (0)
+
+struct gen_opts {
+	size_t count;
+	size_t chunk;
+	size_t threads;
+	unsigned format;
+	unsigned layout;
+	int newline;
+	int use_mmap;
+	int use_vmsplice;
+	const char *path;
+};
+
+struct gen_worker {
+	struct uuid7_gen gen;
+	uint8_t entropy[4096];
+	struct gen_shared *shared;
+	size_t id;
+	uint8_t *ids;
+	char *bufs[2];
+	size_t lens[2];
+	int full[2];
+	thrd_t thread;
+};
+
+struct gen_shared {
+	const struct gen_opts *opts;
+	size_t record;
+	size_t num_chunks;
+	char *map;
+	struct gen_worker *workers;
+	mtx_t mtx;
+	cnd_t cnd;
+	int failed;
+};
+
+static void gen_usage(FILE *out, const char *name)
+{
+	fprintf(out, "usage: %s [-n count] [-f hex|base32|binary] [-r]"
+		" [-t threads]\n\t[-c chunk] [-l seconds|rfc9562]"
+		" [-o file [-m]] [-v]\n"
+		"\t-n  the number of UUIDs (default 1)\n"
+		"\t-f  the format (default hex)\n"
+		"\t-r  a fixed stride, without newlines\n"
+		"\t-t  the number of generating threads (default 1)\n"
+		"\t-c  the UUIDs per chunk of each thread (default 65536)\n"
+		"\t-l  the layout (default seconds)\n"
+		"\t-o  the file to write, rather than stdout\n"
+		"\t-m  map the file, and format in place\n"
+		"\t-v  vmsplice the buffers in to stdout, a pipe\n"
+		"The high bits of the segment may be fixed by UUID7_SEGMENT,"
+		" as \"node\" or \"node/bits\".\n", name);
+}
+
+static size_t gen_parse_size(const char *name, const char *str)
+{
+	char *end = NULL;
+	errno = 0;
+	unsigned long long ull = strtoull(str, &end, 10);
+	if (errno || !end || end == str || *end || str[0] == '-'
+	    || ull > SIZE_MAX) {
+		fprintf(stderr, "%s: not a count: '%s'\n", name, str);
+		exit(EXIT_FAILURE);
+	}
+	return (size_t)ull;
+}
+
+static size_t gen_record_size(const struct gen_opts *opts)
+{
+	switch (opts->format) {
+	case GEN_FORMAT_BINARY:
+		return 16;
+	case GEN_FORMAT_BASE32:
+		return 26 + (opts->newline ? 1 : 0);
+	default:
+		return 36 + (opts->newline ? 1 : 0);
+	}
+}
+
+static void *gen_alloc(size_t size)
+{
+	size_t rounded = ((size + GEN_PAGE - 1) / GEN_PAGE) * GEN_PAGE;
+	return aligned_alloc(GEN_PAGE, rounded ? rounded : GEN_PAGE);
+}
+
+/* formats the ids in to dst; returns 0, or -1 if they could not be made */
+static int gen_fill(struct gen_worker *w, char *dst, size_t n)
+{
+	const struct gen_opts *opts = w->shared->opts;
+	size_t record = w->shared->record;
+	if (opts->format == GEN_FORMAT_BINARY) {
+		return uuid7_gen_n(&w->gen, (uint8_t *)dst, n) ? 0 : -1;
+	}
+	if (!uuid7_gen_n(&w->gen, w->ids, n)) {
+		return -1;
+	}
+	if (opts->format == GEN_FORMAT_BASE32) {
+		uuid7_to_base32_n(dst, n * record, w->ids, n, record);
+	} else {
+		uuid7_to_string_n(dst, n * record, w->ids, n, record);
+	}
+	if (opts->newline) {
+		for (size_t i = 0; i < n; ++i) {
+			dst[(i * record) + record - 1] = '\n';
+		}
+	}
+	return 0;
+}
+
+static size_t gen_chunk_len(const struct gen_shared *shared, size_t c)
+{
+	size_t chunk = shared->opts->chunk;
+	size_t begin = c * chunk;
+	size_t left = shared->opts->count - begin;
+	return left < chunk ? left : chunk;
+}
+
+static int gen_thread_func(void *context)
+{
+	struct gen_worker *w = (struct gen_worker *)context;
+	struct gen_shared *shared = w->shared;
+	size_t threads = shared->opts->threads;
+	size_t record = shared->record;
+
+	for (size_t c = w->id, k = 0; c < shared->num_chunks; c += threads) {
+		size_t n = gen_chunk_len(shared, c);
+		if (shared->map) {
+			char *dst = shared->map + (c * shared->opts->chunk
+						   * record);
+			if (gen_fill(w, dst, n)) {
+				goto fail;
+			}
+			continue;
+		}
+		size_t b = k++ % 2;
+		mtx_lock(&shared->mtx);
+		while (w->full[b] && !shared->failed) {
+			cnd_wait(&shared->cnd, &shared->mtx);
+		}
+		int failed = shared->failed;
+		mtx_unlock(&shared->mtx);
+		if (failed) {
+			return -1;
+		}
+		if (gen_fill(w, w->bufs[b], n)) {
+			goto fail;
+		}
+		mtx_lock(&shared->mtx);
+		w->lens[b] = n * record;
+		w->full[b] = 1;
+		cnd_broadcast(&shared->cnd);
+		mtx_unlock(&shared->mtx);
+	}
+	return 0;
+
+fail:
+	fprintf(stderr, "uuid7_gen_n failed\n");
+	mtx_lock(&shared->mtx);
+	shared->failed = 1;
+	cnd_broadcast(&shared->cnd);
+	mtx_unlock(&shared->mtx);
+	return -1;
+}
+
+/* returns 0 once all len bytes are written, or -1 */
+static int gen_write(int fd, const char *buf, size_t len, int use_vmsplice)
+{
+	size_t pos = 0;
+	while (pos < len) {
+		ssize_t written;
+#ifdef __linux__
+		if (use_vmsplice) {
+			struct iovec iov;
+			iov.iov_base = (void *)(uintptr_t)(buf + pos);
+			iov.iov_len = len - pos;
+			written = vmsplice(fd, &iov, 1, 0);
+		} else
+#endif
+		{
+			written = write(fd, buf + pos, len - pos);
+		}
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		pos += (size_t)written;
+	}
+	return 0;
+}
+
+/*
+   The pages of a vmsplice belong to the pipe until read, thus a buffer
+   is not refilled until the chunk after it is also in the pipe: as the
+   chunks are at least the size of the pipe, by then it has been read.
+*/
+static int gen_write_chunks(struct gen_shared *shared, int fd)
+{
+	const struct gen_opts *opts = shared->opts;
+	struct gen_worker *held = NULL;
+	size_t held_b = 0;
+	int rv = 0;
+
+	for (size_t c = 0; c < shared->num_chunks; ++c) {
+		struct gen_worker *w = &shared->workers[c % opts->threads];
+		size_t b = (c / opts->threads) % 2;
+
+		mtx_lock(&shared->mtx);
+		while (!w->full[b] && !shared->failed) {
+			cnd_wait(&shared->cnd, &shared->mtx);
+		}
+		int failed = shared->failed;
+		mtx_unlock(&shared->mtx);
+		if (failed) {
+			return -1;
+		}
+
+		if (gen_write(fd, w->bufs[b], w->lens[b], opts->use_vmsplice)) {
+			perror("write");
+			rv = -1;
+		}
+
+		mtx_lock(&shared->mtx);
+		if (rv) {
+			shared->failed = 1;
+		}
+		if (held) {
+			held->full[held_b] = 0;
+			held = NULL;
+		}
+		if (opts->use_vmsplice) {
+			held = w;
+			held_b = b;
+		} else {
+			w->full[b] = 0;
+		}
+		cnd_broadcast(&shared->cnd);
+		mtx_unlock(&shared->mtx);
+		if (rv) {
+			return rv;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct gen_opts opts;
+	memset(&opts, 0x00, sizeof(opts));
+	opts.count = 1;
+	opts.chunk = 65536;
+	opts.threads = 1;
+	opts.format = GEN_FORMAT_HEX;
+	opts.layout = UUID7_LAYOUT_SECONDS;
+	opts.newline = 1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:f:rt:c:l:o:mvh")) != -1) {
+		switch (opt) {
+		case 'n':
+			opts.count = gen_parse_size(argv[0], optarg);
+			break;
+		case 'f':
+			if (strcmp(optarg, "hex") == 0) {
+				opts.format = GEN_FORMAT_HEX;
+			} else if (strcmp(optarg, "base32") == 0) {
+				opts.format = GEN_FORMAT_BASE32;
+			} else if (strcmp(optarg, "binary") == 0) {
+				opts.format = GEN_FORMAT_BINARY;
+			} else {
+				gen_usage(stderr, argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			opts.newline = 0;
+			break;
+		case 't':
+			opts.threads = gen_parse_size(argv[0], optarg);
+			break;
+		case 'c':
+			opts.chunk = gen_parse_size(argv[0], optarg);
+			break;
+		case 'l':
+			if (strcmp(optarg, "seconds") == 0) {
+				opts.layout = UUID7_LAYOUT_SECONDS;
+			} else if (strcmp(optarg, "rfc9562") == 0) {
+				opts.layout = UUID7_LAYOUT_RFC9562;
+			} else {
+				gen_usage(stderr, argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'o':
+			opts.path = optarg;
+			break;
+		case 'm':
+			opts.use_mmap = 1;
+			break;
+		case 'v':
+			opts.use_vmsplice = 1;
+			break;
+		case 'h':
+			gen_usage(stdout, argv[0]);
+			return EXIT_SUCCESS;
+		default:
+			gen_usage(stderr, argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || !opts.threads || !opts.chunk
+	    || (opts.use_mmap && !opts.path)) {
+		gen_usage(stderr, argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (opts.format == GEN_FORMAT_BINARY) {
+		opts.newline = 0;
+	}
+#ifndef __linux__
+	opts.use_vmsplice = 0;
+#endif
+	if (uuid7_set_segment_env() < 0) {
+		fprintf(stderr, "%s: not a segment: UUID7_SEGMENT='%s'\n",
+			argv[0], getenv("UUID7_SEGMENT"));
+		return EXIT_FAILURE;
+	}
+
+	struct gen_shared shared;
+	memset(&shared, 0x00, sizeof(shared));
+	shared.opts = &opts;
+	shared.record = gen_record_size(&opts);
+	if (opts.count > (SIZE_MAX / shared.record)) {
+		Die("%zu UUIDs of %zu bytes is too many", opts.count,
+		    shared.record);
+	}
+	size_t total = opts.count * shared.record;
+
+	int fd = STDOUT_FILENO;
+	if (opts.path) {
+		int flags = opts.use_mmap ? O_RDWR : O_WRONLY;
+		fd = open(opts.path, flags | O_CREAT | O_TRUNC, 0666);
+		if (fd < 0) {
+			Die("open(\"%s\")", opts.path);
+		}
+		opts.use_vmsplice = 0;
+	}
+#ifdef __linux__
+	if (opts.use_vmsplice) {
+		int pipe_size = fcntl(fd, F_GETPIPE_SZ);
+		if (pipe_size < 0) {
+			Die("-v requires stdout to be a pipe");
+		}
+		size_t min_chunk = (((size_t)pipe_size) + shared.record - 1)
+		    / shared.record;
+		if (opts.chunk < min_chunk) {
+			opts.chunk = min_chunk;
+		}
+	}
+#endif
+	if (opts.chunk > (SIZE_MAX / 16) / 2) {
+		Die("a chunk of %zu UUIDs is too large", opts.chunk);
+	}
+	shared.num_chunks = (opts.count + opts.chunk - 1) / opts.chunk;
+	if (opts.threads > shared.num_chunks) {
+		opts.threads = shared.num_chunks ? shared.num_chunks : 1;
+	}
+
+	if (opts.use_mmap && total) {
+		if (ftruncate(fd, (off_t)total)) {
+			Die("ftruncate(\"%s\", %zu)", opts.path, total);
+		}
+		void *map = mmap(NULL, total, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED) {
+			Die("mmap(\"%s\", %zu)", opts.path, total);
+		}
+		shared.map = (char *)map;
+	}
+
+	size_t workers_size = opts.threads * sizeof(struct gen_worker);
+	shared.workers = (struct gen_worker *)aligned_alloc(UUID7_CACHE_LINE,
+							     workers_size);
+	if (!shared.workers) {
+		Die("failed to allocate %zu bytes?", workers_size);
+	}
+	memset(shared.workers, 0x00, workers_size);
+
+	size_t chunk_size = opts.chunk * shared.record;
+	for (size_t i = 0; i < opts.threads; ++i) {
+		struct gen_worker *w = &shared.workers[i];
+		w->shared = &shared;
+		w->id = i;
+		uuid7_gen_init(&w->gen, w->entropy, sizeof(w->entropy));
+		uuid7_gen_layout(&w->gen, opts.layout);
+		uuid7_gen_policy(&w->gen, UUID7_POLICY_BORROW);
+		if (opts.format != GEN_FORMAT_BINARY) {
+			w->ids = (uint8_t *)gen_alloc(opts.chunk * 16);
+			if (!w->ids) {
+				Die("failed to allocate %zu bytes?",
+				    opts.chunk * 16);
+			}
+		}
+		if (!shared.map) {
+			for (size_t b = 0; b < 2; ++b) {
+				w->bufs[b] = (char *)gen_alloc(chunk_size);
+				if (!w->bufs[b]) {
+					Die("failed to allocate %zu bytes?",
+					    chunk_size);
+				}
+			}
+		}
+	}
+
+	if (mtx_init(&shared.mtx, mtx_plain) != thrd_success
+	    || cnd_init(&shared.cnd) != thrd_success) {
+		Die("mtx_init or cnd_init failed");
+	}
+	for (size_t i = 0; i < opts.threads; ++i) {
+		struct gen_worker *w = &shared.workers[i];
+		if (thrd_create(&w->thread, gen_thread_func, w)
+		    != thrd_success) {
+			Die("thrd_create %zu failed", i);
+		}
+	}
+
+	int rv = shared.map ? 0 : gen_write_chunks(&shared, fd);
+
+	for (size_t i = 0; i < opts.threads; ++i) {
+		int res = 0;
+		thrd_join(shared.workers[i].thread, &res);
+		rv = rv ? rv : res;
+	}
+
+	if (shared.map && munmap(shared.map, total)) {
+		perror("munmap");
+		rv = -1;
+	}
+	if (opts.path && close(fd)) {
+		perror("close");
+		rv = -1;
+	}
+
+	cnd_destroy(&shared.cnd);
+	mtx_destroy(&shared.mtx);
+	for (size_t i = 0; i < opts.threads; ++i) {
+		free(shared.workers[i].ids);
+		free(shared.workers[i].bufs[0]);
+		free(shared.workers[i].bufs[1]);
+	}
+	free(shared.workers);
+
+	return rv ? EXIT_FAILURE : EXIT_SUCCESS;
+}
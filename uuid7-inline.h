@@ -0,0 +1,326 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/* Copyright (C) 2024 Eric Herman <eric@freesa.org> */
+
+/*
+   The stateless encode, decode, and format routines, included by uuid7.h
+   as "static inline" for UUID7_HEADER_ONLY, or as the out-of-line
+   definitions, when uuid7.c defines UUID7_IMPLEMENTATION.
+   Not to be included directly.
+*/
+#ifndef UUID7_INLINE_H
+#define UUID7_INLINE_H
+
+#ifndef UUID7_H
+#error "include uuid7.h rather than uuid7-inline.h"
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#ifdef UUID7_HEADER_ONLY
+#define UUID7_INLINE static inline
+#else
+#define UUID7_INLINE
+#endif
+
+UUID7_INLINE uint8_t *uuid7_pack(uint8_t *ubuf, struct timespec ts,
+				 uint16_t segment, uint32_t random_bytes)
+{
+	assert(ubuf);
+	assert(ts.tv_nsec >= 0 && ts.tv_nsec <= 999999999);
+
+	/*
+	   With only 24 bits of the fraction second,
+	   wanted are the 24 most significant bits,
+	   which might not be zero.
+	   Valid values are 0 to 999999999 or:
+	   const uint32_t nine9s = 0x3B9AC9FF;
+	   Because the bits 31 and 30 are never set,
+	   only bits 0-29, the bits to extract are 6 through 29:
+	   0011 1011 1001 1010 1100 1001 1111 1111
+	   --++ ++++ ++++ ++++ ++++ ++++ ++-- ----
+	   3    F    F    F    F    F    C    0
+
+	   However, since modern clocks really are nanosecond time,
+	   we will put those last 6 bits from the time in to the 6
+	   high bits of the 14 bit sequence number, 255 values for
+	   sequences created in the same nanosecond.
+	 */
+
+	uint64_t seconds = (((uint64_t)ts.tv_sec) & 0x0000000FFFFFFFFF);
+	uint16_t hifrac =
+	    ((((uint32_t)ts.tv_nsec) & 0x3FFC0000) >> (2 + (4 * 4)));
+
+	uint16_t lofrac = ((((uint32_t)ts.tv_nsec) & 0x0003FFC0) >> (4 + 2));
+	uint8_t hiseq = (ts.tv_nsec & 0x3F);
+
+	ubuf[0] = (seconds & 0x0000000FF0000000) >> (7 * 4);
+	ubuf[1] = (seconds & 0x000000000FF00000) >> (5 * 4);
+	ubuf[2] = (seconds & 0x00000000000FF000) >> (3 * 4);
+	ubuf[3] = (seconds & 0x0000000000000FF0) >> (1 * 4);
+	ubuf[4] = (((seconds & 0x000000000000000F) << (1 * 4))
+		   | ((hifrac & 0x0F00) >> (2 * 4)));
+	ubuf[5] = (hifrac & 0x00FF);
+	ubuf[6] = (((UUID7_VERSION & 0x0F) << 4)
+		   | ((lofrac & 0x0F00) >> (2 * 4)));
+	ubuf[7] = (lofrac & 0x00FF);
+	ubuf[8] = ((UUID7_VARIANT & 0x03) << 6) | hiseq;
+	ubuf[9] = 0x00;
+	ubuf[10] = ((segment & 0xFF00) >> 8);
+	ubuf[11] = ((segment & 0x00FF));
+	ubuf[12] = (random_bytes & 0x00000000000000FF) >> (0 * 8);
+	ubuf[13] = (random_bytes & 0x000000000000FF00) >> (1 * 8);
+	ubuf[14] = (random_bytes & 0x0000000000FF0000) >> (2 * 8);
+	ubuf[15] = (random_bytes & 0x00000000FF000000) >> (3 * 8);
+
+	return ubuf;
+}
+
+/*
+   RFC 9562: 48 bits of unix_ts_ms, the version, 12 bits of the fraction
+   of the millisecond (method 3), the variant, a 14 bit counter of zero,
+   then the segment and random bytes as above.
+*/
+UUID7_INLINE uint8_t *uuid7_pack_rfc9562(uint8_t *ubuf, struct timespec ts,
+					 uint16_t segment,
+					 uint32_t random_bytes)
+{
+	assert(ubuf);
+	assert(ts.tv_nsec >= 0 && ts.tv_nsec <= 999999999);
+
+	uint64_t ms = ((((uint64_t)ts.tv_sec) * 1000) + (ts.tv_nsec / 1000000))
+	    & 0x0000FFFFFFFFFFFF;
+	uint16_t subms = ((((uint32_t)ts.tv_nsec) % 1000000) * 4096) / 1000000;
+
+	ubuf[0] = (ms & 0x0000FF0000000000) >> (5 * 8);
+	ubuf[1] = (ms & 0x000000FF00000000) >> (4 * 8);
+	ubuf[2] = (ms & 0x00000000FF000000) >> (3 * 8);
+	ubuf[3] = (ms & 0x0000000000FF0000) >> (2 * 8);
+	ubuf[4] = (ms & 0x000000000000FF00) >> (1 * 8);
+	ubuf[5] = (ms & 0x00000000000000FF);
+	ubuf[6] = (((UUID7_VERSION & 0x0F) << 4) | ((subms & 0x0F00) >> 8));
+	ubuf[7] = (subms & 0x00FF);
+	ubuf[8] = ((UUID7_VARIANT_RFC9562 & 0x03) << 6);
+	ubuf[9] = 0x00;
+	ubuf[10] = ((segment & 0xFF00) >> 8);
+	ubuf[11] = ((segment & 0x00FF));
+	ubuf[12] = (random_bytes & 0x000000FF) >> (0 * 8);
+	ubuf[13] = (random_bytes & 0x0000FF00) >> (1 * 8);
+	ubuf[14] = (random_bytes & 0x00FF0000) >> (2 * 8);
+	ubuf[15] = (random_bytes & 0xFF000000) >> (3 * 8);
+
+	return ubuf;
+}
+
+/*
+   The seconds, and the 24 bits of fraction in units of 64 ns, rounded
+   up from the start of the 1/4096 ms, thus within the same 1/4096 ms.
+   The 14 bit counter is the hiseq and loseq.
+*/
+static inline void uuid7_parts_rfc9562(struct uuid7 *u, const uint8_t *bytes)
+{
+	uint64_t ms = ((((uint64_t)bytes[0]) << (5 * 8))
+		       | (((uint64_t)bytes[1]) << (4 * 8))
+		       | (((uint64_t)bytes[2]) << (3 * 8))
+		       | (((uint64_t)bytes[3]) << (2 * 8))
+		       | (((uint64_t)bytes[4]) << (1 * 8))
+		       | (((uint64_t)bytes[5]) << (0 * 8)));
+	uint32_t subms = (((uint32_t)(bytes[6] & 0x0F)) << 8) | bytes[7];
+	uint32_t nanos = ((uint32_t)(ms % 1000)) * 1000000
+	    + (((subms * 1000000) + 4095) / 4096);
+	uint32_t frac = (nanos + 63) >> 6;
+
+	u->seconds = ms / 1000;
+	u->hifrac = (frac >> 12) & 0x0FFF;
+	u->lofrac = frac & 0x0FFF;
+	u->hiseq = bytes[8] & 0x3F;
+}
+
+UUID7_INLINE struct uuid7 *uuid7_parts(struct uuid7 *u, const uint8_t *bytes)
+{
+	assert(u);
+	assert(bytes);
+
+	u->seconds = ((((uint64_t)bytes[0]) << (7 * 4))
+		      | (((uint64_t)bytes[1]) << (5 * 4))
+		      | (((uint64_t)bytes[2]) << (3 * 4))
+		      | (((uint64_t)bytes[3]) << (1 * 4))
+		      | (((uint64_t)bytes[4]) >> (1 * 4)));
+
+	u->hifrac = ((((uint16_t)bytes[4] & 0x0F) << 8) | bytes[5]);
+	u->uuid_ver = (bytes[6] & 0xF0) >> 4;
+	u->lofrac = (((uint16_t)(bytes[6] & 0x0F)) << 8) | bytes[7];
+	u->uuid_var = (bytes[8] & 0xC0) >> 6;
+	u->hiseq = bytes[8] & 0x3F;
+	u->loseq = bytes[9];
+	u->segment = (((uint16_t)bytes[10]) << 8) | bytes[11];
+
+	u->rand = (((uint64_t)bytes[15]) << (8 * 3))
+	    | (((uint64_t)bytes[14]) << (8 * 2))
+	    | (((uint64_t)bytes[13]) << (8 * 1))
+	    | (((uint64_t)bytes[12]) << (8 * 0));
+
+	if (u->uuid_var == UUID7_VARIANT_RFC9562) {
+		uuid7_parts_rfc9562(u, bytes);
+	}
+
+	return u->uuid_ver == UUID7_VERSION
+	    && (u->uuid_var == UUID7_VARIANT
+		|| u->uuid_var == UUID7_VARIANT_RFC9562) ? u : NULL;
+}
+
+/* writes the 36 characters of 8-4-4-4-12, without a NUL */
+static inline void uuid7_hex36(char *dst, const uint8_t *bytes)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t pos = 0;
+	for (size_t i = 0; i < 16; ++i) {
+		if (i == 4 || i == 6 || i == 8 || i == 10) {
+			dst[pos++] = '-';
+		}
+		dst[pos++] = hex[(bytes[i] & 0xF0) >> 4];
+		dst[pos++] = hex[(bytes[i] & 0x0F)];
+	}
+}
+
+static inline size_t uuid7_minz(size_t a, size_t b)
+{
+	return (a < b) ? a : b;
+}
+
+UUID7_INLINE char *uuid7_to_string(char *buf, size_t buf_size,
+				   const uint8_t *bytes)
+{
+	assert(buf);
+	const size_t uuid_str_size = ((16 * 2) + 4) + 1;
+	memset(buf, 0x00, uuid7_minz(uuid_str_size, buf_size));
+	if (buf_size < uuid_str_size) {
+		return NULL;
+	}
+	uuid7_hex36(buf, bytes);
+	return buf;
+}
+
+/* the first 8 bytes as a number, most significant first */
+static inline uint64_t uuid7_load_be64(const uint8_t *bytes)
+{
+	uint64_t v;
+	memcpy(&v, bytes, 8);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	return v;
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__)
+	return __builtin_bswap64(v);
+#else
+	v = 0;
+	for (size_t i = 0; i < 8; ++i) {
+		v = (v << 8) | bytes[i];
+	}
+	return v;
+#endif
+}
+
+static inline void uuid7_store_be64(uint8_t *bytes, uint64_t v)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	memcpy(bytes, &v, 8);
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__)
+	v = __builtin_bswap64(v);
+	memcpy(bytes, &v, 8);
+#else
+	for (size_t i = 0; i < 8; ++i) {
+		bytes[i] = (v >> (8 * (7 - i))) & 0xFF;
+	}
+#endif
+}
+
+UUID7_INLINE struct uuid7_u128 uuid7_to_u128(const uint8_t *bytes)
+{
+	assert(bytes);
+	struct uuid7_u128 v;
+	v.hi = uuid7_load_be64(bytes);
+	v.lo = uuid7_load_be64(bytes + 8);
+	return v;
+}
+
+UUID7_INLINE uint8_t *uuid7_from_u128(uint8_t *ubuf, struct uuid7_u128 v)
+{
+	assert(ubuf);
+	uuid7_store_be64(ubuf, v.hi);
+	uuid7_store_be64(ubuf + 8, v.lo);
+	return ubuf;
+}
+
+UUID7_INLINE int uuid7_u128_compare(struct uuid7_u128 a, struct uuid7_u128 b)
+{
+	if (a.hi != b.hi) {
+		return (a.hi < b.hi) ? -1 : 1;
+	}
+	return (a.lo > b.lo) - (a.lo < b.lo);
+}
+
+UUID7_INLINE int uuid7_compare(const void *a, const void *b)
+{
+	assert(a);
+	assert(b);
+	return uuid7_u128_compare(uuid7_to_u128((const uint8_t *)a),
+				  uuid7_to_u128((const uint8_t *)b));
+}
+
+UUID7_INLINE uint64_t uuid7_timestamp_ns(const uint8_t *bytes)
+{
+	assert(bytes);
+	uint64_t hi = uuid7_load_be64(bytes);
+	if (((bytes[8] & 0xC0) >> 6) == UUID7_VARIANT_RFC9562) {
+		/* the first nanosecond of the 1/4096 ms, as uuid7_parts */
+		uint64_t ms = hi >> 16;
+		uint64_t subms = hi & 0x0FFF;
+		return (ms * 1000000) + (((subms * 1000000) + 4095) / 4096);
+	}
+	uint64_t seconds = hi >> 28;
+	uint64_t nanos = (((hi >> 16) & 0x0FFF) << 18)
+	    | ((hi & 0x0FFF) << 6)
+	    | (bytes[8] & 0x3F);
+	return (seconds * 1000000000) + nanos;
+}
+
+UUID7_INLINE uint64_t uuid7_hash64(const uint8_t *bytes)
+{
+	assert(bytes);
+	uint64_t hi = uuid7_load_be64(bytes);
+	uint64_t lo = uuid7_load_be64(bytes + 8);
+	/* the time, spread by an odd multiply, over the sequence and random */
+	uint64_t x = lo ^ (hi * UINT64_C(0x9E3779B97F4A7C15));
+	/* the finalizer of MurmurHash3, each output bit of each input bit */
+	x ^= x >> 33;
+	x *= UINT64_C(0xFF51AFD7ED558CCD);
+	x ^= x >> 33;
+	x *= UINT64_C(0xC4CEB9FE1A85EC53);
+	x ^= x >> 33;
+	return x;
+}
+
+UUID7_INLINE uint8_t *uuid7_min_for_time(uint8_t *ubuf, struct timespec ts,
+					 unsigned layout)
+{
+	if (layout == UUID7_LAYOUT_RFC9562) {
+		return uuid7_pack_rfc9562(ubuf, ts, 0x0000, 0x00000000);
+	}
+	return uuid7_pack(ubuf, ts, 0x0000, 0x00000000);
+}
+
+UUID7_INLINE uint8_t *uuid7_max_for_time(uint8_t *ubuf, struct timespec ts,
+					 unsigned layout)
+{
+	if (layout == UUID7_LAYOUT_RFC9562) {
+		uuid7_pack_rfc9562(ubuf, ts, 0xFFFF, 0xFFFFFFFF);
+		/* the highest of the 14 bit counter */
+		ubuf[8] |= 0x3F;
+	} else {
+		uuid7_pack(ubuf, ts, 0xFFFF, 0xFFFFFFFF);
+	}
+	ubuf[9] = 0xFF;
+	return ubuf;
+}
+
+#undef UUID7_INLINE
+#endif /* UUID7_INLINE_H */
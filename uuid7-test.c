@@ -1,6 +1,11 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 /* Copyright (C) 2024 Eric Herman <eric@freesa.org> */
 
+#ifdef UUID7_PER_CPU
+/* for sched_setaffinity */
+#define _GNU_SOURCE
+#endif
+
 #include "uuid7.h"
 
 #include <errno.h>
@@ -10,6 +15,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#ifndef UUID7_NO_THREADS
+#include <threads.h>
+#endif
 
 static uint32_t uuid7_nanos(struct uuid7 u)
 {
@@ -254,8 +262,17 @@ unsigned check_parts(void)
 	}
 
 	rv = uuid7_next(ubuf, ts, segment, random_bytes, last);
+#ifdef UUID7_NEVER_FAIL
+	/* the next nanosecond is borrowed, here in to the next second */
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	uuid7_parts(&u, ubuf);
+	failures += Check(u.seconds, ts.tv_sec + 1);
+	failures += Check(uuid7_nanos(u), 0);
+	failures += Check(u.loseq, 0);
+#else
 	failures += Check((intptr_t)rv, (intptr_t)NULL);
 	failures += Check_s((const char *)ubuf, "");
+#endif
 
 	return failures;
 }
@@ -287,177 +304,2937 @@ unsigned check_to_string(void)
 }
 
 /* global variable defined in uuid7.c, but not exposed in uuid7.h */
-extern clockid_t uuid7_clockid;
+extern int uuid7_hex_simd;
 
-unsigned check_bad_clock_id(void)
+static unsigned check_to_string_n_stride(size_t stride)
 {
 	unsigned failures = 0;
+	const size_t count = 17;
+	uint8_t ids[17 * 16];
+	for (size_t i = 0; i < sizeof(ids); ++i) {
+		ids[i] = (uint8_t)(i * 7);
+	}
 
-	clockid_t orig_clockid = uuid7_clockid;
-	uuid7_clockid = 1234567;	/* assumed to be bogus */
+	char out[17 * 37];
+	memset(out, '?', sizeof(out));
+	char *rv = uuid7_to_string_n(out, sizeof(out), ids, count, stride);
+	failures += Check((intptr_t)rv, (intptr_t)out);
+
+	for (size_t i = 0; i < count; ++i) {
+		char expect[40];
+		char got[40];
+		uuid7_to_string(expect, sizeof(expect), ids + (i * 16));
+		memcpy(got, out + (i * stride), 36);
+		got[36] = '\0';
+		failures += Check_s(got, expect);
+		if (stride == 37) {
+			failures += Check(out[(i * stride) + 36], '\0');
+		}
+	}
+	return failures;
+}
 
-	uint8_t ubuf[16];
-	memset(ubuf, '?', sizeof(ubuf));
+unsigned check_to_string_n(void)
+{
+	unsigned failures = 0;
 
-	uint8_t *rv = uuid7(ubuf);
+	for (int simd = 1; simd >= 0; --simd) {
+		uuid7_hex_simd = simd;
+		failures += check_to_string_n_stride(36);
+		failures += check_to_string_n_stride(37);
+	}
+	uuid7_hex_simd = 1;
+
+	uint8_t ids[2 * 16] = { 0 };
+	char out[2 * 37];
+
+	memset(out, '?', sizeof(out));
+	char *rv = uuid7_to_string_n(out, (2 * 37) - 1, ids, 2, 37);
 	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check(out[0], '\0');
+	failures += Check(out[(2 * 37) - 2], '\0');
+	failures += Check(out[(2 * 37) - 1], '?');
 
-	uuid7_clockid = orig_clockid;
+	rv = uuid7_to_string_n(out, sizeof(out), ids, 2, 35);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	rv = uuid7_to_string_n(out, sizeof(out), ids, SIZE_MAX, 36);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	rv = uuid7_to_string_n(out, sizeof(out), ids, 0, 36);
+	failures += Check((intptr_t)rv, (intptr_t)out);
 
 	return failures;
 }
 
-/* friend function defined in uui7.c, but not exposed in uuid7.h */
-extern int (*uuid7_clock_gettime)(clockid_t clockid, struct timespec *tp);
-
-time_t uuid7_test_bogus_clock_sec = 0;
-long uuid7_test_bogus_clock_nsec = 0;
-int uuid7_test_bogus_clock_rv = 0;
-int uuid7_test_bogus_clock_gettime(clockid_t clockid, struct timespec *tp)
+static unsigned check_from_string_simd(void)
 {
-	(void)clockid;
+	unsigned failures = 0;
+	const char *canonical = "01234567-89ab-7cde-5f01-23456789abcd";
+	const char *upper = "01234567-89AB-7CDE-5F01-23456789ABCD";
+	const char *bare = "0123456789ab7cde5f0123456789abcd";
+	const uint8_t bytes[16] = {
+		0x01, 0x23, 0x45, 0x67,
+		0x89, 0xab, 0x7c, 0xde,
+		0x5f, 0x01, 0x23, 0x45,
+		0x67, 0x89, 0xab, 0xcd
+	};
+	uint8_t ubuf[16];
 
-	if (tp) {
-		tp->tv_sec = uuid7_test_bogus_clock_sec;
-		tp->tv_nsec = uuid7_test_bogus_clock_nsec;
+	uint8_t *rv = uuid7_from_string(ubuf, canonical, 36);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	failures += Check(memcmp(ubuf, bytes, 16), 0);
+
+	memset(ubuf, 0x00, 16);
+	rv = uuid7_from_string(ubuf, upper, 36);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	failures += Check(memcmp(ubuf, bytes, 16), 0);
+
+	memset(ubuf, 0x00, 16);
+	rv = uuid7_from_string(ubuf, bare, 32);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	failures += Check(memcmp(ubuf, bytes, 16), 0);
+
+	const uint8_t zeros[16] = { 0 };
+	rv = uuid7_from_string(ubuf, canonical, 35);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check(memcmp(ubuf, zeros, 16), 0);
+
+	/* a dash where a digit should be, and a digit where a dash should be */
+	rv = uuid7_from_string(ubuf, canonical, 32);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	rv = uuid7_from_string(ubuf, "012345678-9ab-7cde-5f01-23456789abc", 36);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	/* not a version 7 */
+	rv = uuid7_from_string(ubuf, "01234567-89ab-4cde-5f01-23456789abcd",
+			       36);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check(memcmp(ubuf, zeros, 16), 0);
+
+	/* every non-hex neighbour of the hex ranges, in each position */
+	const char not_hex[] = { '/', ':', '@', 'G', '`', 'g', ' ', '\x80' };
+	for (size_t i = 0; i < 36; ++i) {
+		if (i == 8 || i == 13 || i == 18 || i == 23) {
+			continue;
+		}
+		for (size_t j = 0; j < sizeof(not_hex); ++j) {
+			char str[37];
+			memcpy(str, canonical, 37);
+			str[i] = not_hex[j];
+			rv = uuid7_from_string(ubuf, str, 36);
+			failures += Check((intptr_t)rv, (intptr_t)NULL);
+		}
+	}
+	for (size_t i = 0; i < 32; ++i) {
+		char str[33];
+		memcpy(str, bare, 33);
+		str[i] = 'x';
+		rv = uuid7_from_string(ubuf, str, 32);
+		failures += Check((intptr_t)rv, (intptr_t)NULL);
 	}
 
-	return uuid7_test_bogus_clock_rv;
-}
+	/* generated ones survive the round trip */
+	uint8_t ids[8 * 16];
+	char strs[8 * 37];
+	uint8_t parsed[8 * 16];
+	failures += Check((intptr_t)uuid7_n(ids, 8), (intptr_t)ids);
+	uuid7_to_string_n(strs, sizeof(strs), ids, 8, 37);
+	rv = uuid7_from_string_n(parsed, strs, 8, 36, 37);
+	failures += Check((intptr_t)rv, (intptr_t)parsed);
+	failures += Check(memcmp(parsed, ids, sizeof(ids)), 0);
+
+	/* one bad entry is zeroed, the others are still parsed */
+	strs[(3 * 37) + 5] = 'z';
+	rv = uuid7_from_string_n(parsed, strs, 8, 36, 37);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check(memcmp(parsed + (3 * 16), zeros, 16), 0);
+	failures += Check(memcmp(parsed, ids, 3 * 16), 0);
+	failures += Check(memcmp(parsed + (4 * 16), ids + (4 * 16), 4 * 16), 0);
 
-void uuid7_reset(void);
+	return failures;
+}
 
-unsigned check_bad_gettime(void)
+unsigned check_from_string(void)
 {
 	unsigned failures = 0;
 
-	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
-	    uuid7_clock_gettime;
+	for (int simd = 1; simd >= 0; --simd) {
+		uuid7_hex_simd = simd;
+		failures += check_from_string_simd();
+	}
+	uuid7_hex_simd = 1;
 
-	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
-	uuid7_test_bogus_clock_rv = 1;
+	uint8_t out[2 * 16];
+	char strs[2 * 36];
+	memset(strs, '0', sizeof(strs));
+	memset(out, '?', sizeof(out));
+	uint8_t *rv = uuid7_from_string_n(out, strs, 2, 36, 35);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check(out[0], 0);
+	failures += Check(out[(2 * 16) - 1], 0);
+
+	rv = uuid7_from_string_n(out, strs, SIZE_MAX, 36, 36);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	return failures;
+}
 
+unsigned check_pack(void)
+{
+	unsigned failures = 0;
+	struct timespec ts = { 0x123456789, 999999999 };
 	uint8_t ubuf[16];
-	memset(ubuf, '?', sizeof(ubuf));
+	char buf[80];
 
-	uint8_t *rv = uuid7(ubuf);
-	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	uint8_t *rv = uuid7_pack(ubuf, ts, 0xABCD, 0x01020304);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	uuid7_to_string(buf, sizeof(buf), ubuf);
+	failures += Check_s(buf, "12345678-9ee6-7b27-7f00-abcd04030201");
 
-	uuid7_clock_gettime = orig_gettime;
+	struct uuid7 u;
+	failures += Check((intptr_t)uuid7_parts(&u, ubuf), (intptr_t)&u);
+	failures += Check(u.uuid_ver, UUID7_VERSION);
+	failures += Check(u.uuid_var, UUID7_VARIANT);
 
-	uuid7_reset();
+	/* a version 4 is not a version 7 */
+	ubuf[6] = 0x4b;
+	failures += Check((intptr_t)uuid7_parts(&u, ubuf), (intptr_t)NULL);
+	failures += Check(u.uuid_ver, 4);
 
 	return failures;
 }
 
-unsigned check_backwards_in_time(void)
+static int uuid7_test_sign(int i)
+{
+	return (i > 0) - (i < 0);
+}
+
+unsigned check_compare(void)
 {
 	unsigned failures = 0;
+	uint8_t a[16];
+	uint8_t b[16];
+	uint8_t c[16];
 
-	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
-	    uuid7_clock_gettime;
+	for (size_t i = 0; i < 8; ++i) {
+		a[i] = 0x01 + (0x22 * i);
+		a[8 + i] = 0x11 * i;
+	}
+	struct uuid7_u128 v = uuid7_to_u128(a);
+	failures += Check(v.hi, 0x0123456789ABCDEF);
+	failures += Check(v.lo, 0x0011223344556677);
+	failures += Check((intptr_t)uuid7_from_u128(b, v), (intptr_t)b);
+	failures += Check(uuid7_equal(a, b), 1);
+	failures += Check(uuid7_compare(a, b), 0);
+
+	/* each byte, in each direction, compares as memcmp */
+	for (size_t i = 0; i < 16; ++i) {
+		memcpy(b, a, 16);
+		b[i] ^= 0x80;
+		failures += Check(uuid7_equal(a, b), 0);
+		failures += Check(uuid7_compare(a, b),
+				  uuid7_test_sign(memcmp(a, b, 16)));
+		failures += Check(uuid7_compare(b, a),
+				  uuid7_test_sign(memcmp(b, a, 16)));
+		failures += Check(uuid7_u128_compare(uuid7_to_u128(b),
+						     uuid7_to_u128(a)),
+				  uuid7_test_sign(memcmp(b, a, 16)));
+	}
 
-	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
-	uuid7_test_bogus_clock_sec = 102556800;
-	uuid7_test_bogus_clock_nsec = 0;
-	uuid7_test_bogus_clock_rv = 0;
+	/* as generated, and sorted by qsort */
+	uint8_t ids[100 * 16];
+	for (size_t i = 0; i < 100; ++i) {
+		while (!uuid7(ids + (16 * (99 - i)))) ;
+	}
+	qsort(ids, 100, 16, uuid7_compare);
+	for (size_t i = 1; i < 100; ++i) {
+		if (memcmp(ids + (16 * (i - 1)), ids + (16 * i), 16) >= 0) {
+			Fail("%zu not sorted", i);
+		}
+	}
+	memset(c, 0xFF, 16);
+	failures += Check((uuid7_compare(ids, c) < 0), 1);
 
-	uint8_t ubuf[16];
-	memset(ubuf, '?', sizeof(ubuf));
+	return failures;
+}
 
-	uint8_t *rv = uuid7(ubuf);
-	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+#ifndef UUID7_NO_THREADS
+extern int (*uuid7_thrd_create)(thrd_t *thr, thrd_start_t func, void *arg);
+static int uuid7_test_thrd_create_fail(thrd_t *thr, thrd_start_t func,
+				       void *arg)
+{
+	(void)thr;
+	(void)func;
+	(void)arg;
+	return thrd_error;
+}
 
-	/* set the clock backwards in time: */
-	uuid7_test_bogus_clock_sec -= 1;
+#endif
 
-	rv = uuid7(ubuf);
-	failures += Check((intptr_t)rv, (intptr_t)NULL);
+extern void *(*uuid7_malloc)(size_t size);
+static void *uuid7_test_malloc_fail(size_t size)
+{
+	(void)size;
+	return NULL;
+}
 
-	/* the clock catches back up: */
-	uuid7_test_bogus_clock_sec += 1;
+/* a Fisher-Yates shuffle, with a fixed LCG, of count IDs */
+static void uuid7_test_shuffle(uint8_t *ids, size_t count)
+{
+	uint64_t x = 12345;
+	uint8_t tmp[16];
+	for (size_t i = count; i > 1; --i) {
+		x = (x * 6364136223846793005ULL) + 1442695040888963407ULL;
+		size_t j = (x >> 33) % i;
+		memcpy(tmp, ids + (16 * (i - 1)), 16);
+		memcpy(ids + (16 * (i - 1)), ids + (16 * j), 16);
+		memcpy(ids + (16 * j), tmp, 16);
+	}
+}
 
-	rv = uuid7(ubuf);
-	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+static unsigned uuid7_test_sorted_as(const uint8_t *ids,
+				     const uint8_t *expect, size_t count)
+{
+	unsigned failures = 0;
+	for (size_t i = 0; i < count && !failures; ++i) {
+		if (memcmp(ids + (16 * i), expect + (16 * i), 16)) {
+			char b1[80], b2[80];
+			Fail("%zu: %s != %s", i,
+			     uuid7_to_string(b1, sizeof(b1), ids + (16 * i)),
+			     uuid7_to_string(b2, sizeof(b2),
+					     expect + (16 * i)));
+		}
+	}
+	return failures;
+}
 
-	/* set the clock very far backwards in time: */
-	uuid7_test_bogus_clock_sec = 7776000;
+unsigned check_sort(void)
+{
+	unsigned failures = 0;
+	size_t count = 20000;
+	uint8_t *expect = (uint8_t *)malloc(count * 16);
+	uint8_t *ids = (uint8_t *)malloc(count * 16);
+	uint8_t *out = (uint8_t *)malloc(count * 16);
+	if (!expect || !ids || !out) {
+		Fail("malloc failed");
+		free(expect);
+		free(ids);
+		free(out);
+		return failures;
+	}
 
-	rv = uuid7(ubuf);
-	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	/* a batch, and a tail of the same prefix but in reverse order */
+	while (!uuid7_n(expect, count - 100)) ;
+	for (size_t i = count - 100; i < count; ++i) {
+		memcpy(expect + (16 * i), expect + (16 * (count - 101)), 16);
+		expect[(16 * i) + 10] = 0xFF;
+		expect[(16 * i) + 15] = (uint8_t)i;
+	}
+	uuid7_sort(expect, count);
 
-	/* very "chummy" with the library, call reset(): */
-	uuid7_reset();
+	memcpy(ids, expect, count * 16);
+	failures += Check((intptr_t)uuid7_sort(ids, count), (intptr_t)ids);
+	failures += uuid7_test_sorted_as(ids, expect, count);
 
-	rv = uuid7(ubuf);
-	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	uuid7_test_shuffle(ids, count);
+	uuid7_sort(ids, count);
+	failures += uuid7_test_sorted_as(ids, expect, count);
 
-	uuid7_clock_gettime = orig_gettime;
+	uuid7_test_shuffle(ids, 50);
+	uuid7_sort(ids, 50);
+	failures += uuid7_test_sorted_as(ids, expect, 50);
 
-	uuid7_reset();
+	uuid7_test_shuffle(ids, count);
+	uuid7_sort_parallel(ids, count, 4);
+	failures += uuid7_test_sorted_as(ids, expect, count);
+
+	uuid7_test_shuffle(ids, count);
+	uuid7_sort_parallel(ids, count, 1000);
+	failures += uuid7_test_sorted_as(ids, expect, count);
+
+	uuid7_test_shuffle(ids, 100);
+	uuid7_sort_parallel(ids, 100, 4);
+	failures += uuid7_test_sorted_as(ids, expect, 100);
+
+	/* differing only in the loseq, a single pass */
+	for (size_t i = 0; i < 100; ++i) {
+		memcpy(ids + (16 * i), expect, 16);
+		ids[(16 * i) + 9] = 99 - i;
+	}
+	uuid7_sort(ids, 100);
+	for (size_t i = 0; i < 100; ++i) {
+		failures += Check(ids[(16 * i) + 9], i);
+	}
+	memcpy(ids, expect, count * 16);
+
+	/* without memory, or threads, still sorted */
+	uuid7_malloc = uuid7_test_malloc_fail;
+	uuid7_test_shuffle(ids, count);
+	uuid7_sort(ids, count);
+	failures += uuid7_test_sorted_as(ids, expect, count);
+	uuid7_test_shuffle(ids, count);
+	uuid7_sort_parallel(ids, count, 4);
+	failures += uuid7_test_sorted_as(ids, expect, count);
+	uuid7_malloc = malloc;
+#ifndef UUID7_NO_THREADS
+	uuid7_thrd_create = uuid7_test_thrd_create_fail;
+	uuid7_test_shuffle(ids, count);
+	uuid7_sort_parallel(ids, count, 4);
+	failures += uuid7_test_sorted_as(ids, expect, count);
+	uuid7_thrd_create = thrd_create;
+#endif
 
+	/* runs, as from threads, by every third, and an empty run */
+	size_t lens[4] = { 0, 0, 0, 0 };
+	size_t third = (count + 2) / 3;
+	for (size_t i = 0; i < count; ++i) {
+		size_t r = (i % 3);
+		memcpy(ids + (16 * ((r * third) + lens[r + 1])),
+		       expect + (16 * i), 16);
+		++lens[r + 1];
+	}
+	const uint8_t *runs[4] = { ids, ids, ids + (16 * third),
+		ids + (16 * 2 * third)
+	};
+	failures += Check((intptr_t)uuid7_merge(out, runs, lens, 4),
+			  (intptr_t)out);
+	failures += uuid7_test_sorted_as(out, expect, count);
+
+	uuid7_malloc = uuid7_test_malloc_fail;
+	out[0] = 0xFF;
+	failures += Check((intptr_t)uuid7_merge(out, runs, lens, 4),
+			  (intptr_t)NULL);
+	failures += Check(out[0], 0);
+	uuid7_malloc = malloc;
+
+	/* repeats are removed */
+	memcpy(ids, expect, 16 * 10);
+	memcpy(ids + (16 * 10), expect + (16 * 9), 16);
+	memcpy(ids + (16 * 11), expect + (16 * 9), 16);
+	memcpy(ids + (16 * 12), expect + (16 * 10), 16);
+	failures += Check(uuid7_dedupe(ids, 13), 11);
+	failures += uuid7_test_sorted_as(ids, expect, 11);
+	failures += Check(uuid7_dedupe(ids, 0), 0);
+
+	free(expect);
+	free(ids);
+	free(out);
 	return failures;
 }
 
-/* friend function defined in uui7.c, but not exposed in uuid7.h */
-extern ssize_t (*uuid7_getrandom)(void *buf, size_t buflen, unsigned int flags);
+unsigned check_parts_n(void)
+{
+	unsigned failures = 0;
+	uint8_t ids[4 * 16];
+
+	struct timespec ts = { 0x123456789, 999999999 };
+	uint64_t first = (0x123456789ULL * 1000000000) + 999999999;
+	uuid7_pack(ids, ts, 0xABCD, 0x01020304);
+	failures += Check(uuid7_timestamp_ns(ids), first);
+
+	ts.tv_sec = 1645557742;
+	ts.tv_nsec = 500000;
+	uuid7_pack_rfc9562(ids + 16, ts, 0x0102, 0x04030201);
+	ids[16 + 8] |= 0x12;
+	ids[16 + 9] = 0x34;
+	uint64_t want = (1645557742ULL * 1000000000) + 500000;
+	failures += Check(uuid7_timestamp_ns(ids + 16), want);
+
+	/* within the 1/4096 ms, about 244 ns */
+	ts.tv_nsec = 123456789;
+	uuid7_pack_rfc9562(ids + 32, ts, 0, 0);
+	want = (1645557742ULL * 1000000000) + 123456789;
+	uint64_t ns = uuid7_timestamp_ns(ids + 32);
+	failures += Check((ns <= want && (want - ns) < 245), 1);
+
+	uuid7_pack(ids + 48, ts, 0, 0);
+	ids[48 + 6] = 0x4b;
+
+	uint64_t unix_ns[4];
+	uint16_t segment[4];
+	uint16_t seq[4];
+	uint32_t rand[4];
+	struct uuid7_columns columns = { unix_ns, segment, seq, rand };
+	failures += Check((intptr_t)uuid7_parts_n(&columns, ids, 3),
+			  (intptr_t)&columns);
+	failures += Check(unix_ns[0], first);
+	failures += Check(segment[0], 0xABCD);
+	failures += Check(seq[0], 0);
+	failures += Check(rand[0], 0x01020304);
+	failures += Check(unix_ns[1], (1645557742ULL * 1000000000) + 500000);
+	failures += Check(segment[1], 0x0102);
+	failures += Check(seq[1], 0x1234);
+	failures += Check(rand[1], 0x04030201);
+	failures += Check(unix_ns[2], ns);
+
+	/* a version 4 is zeroed, the others decoded */
+	failures += Check((intptr_t)uuid7_parts_n(&columns, ids, 4),
+			  (intptr_t)NULL);
+	failures += Check(unix_ns[3], 0);
+	failures += Check(segment[3], 0);
+	failures += Check(rand[3], 0);
+	failures += Check(segment[1], 0x0102);
+
+	/* only the columns wanted */
+	struct uuid7_columns times = { unix_ns, NULL, NULL, NULL };
+	unix_ns[0] = 0;
+	segment[0] = 0;
+	failures += Check((intptr_t)uuid7_parts_n(&times, ids, 1),
+			  (intptr_t)&times);
+	failures += Check(unix_ns[0], first);
+	failures += Check(segment[0], 0);
+
+	/* as uuid7_parts, of generated UUIDs */
+	uint8_t batch[100 * 16];
+	uint64_t batch_ns[100];
+	uint16_t batch_seq[100];
+	struct uuid7_columns some = { batch_ns, NULL, batch_seq, NULL };
+	while (!uuid7_n(batch, 100)) ;
+	failures += Check((intptr_t)uuid7_parts_n(&some, batch, 100),
+			  (intptr_t)&some);
+	for (size_t i = 0; i < 100; ++i) {
+		struct uuid7 u;
+		uuid7_parts(&u, batch + (16 * i));
+		uint64_t nanos = uuid7_nanos(u);
+		failures += Check(batch_ns[i],
+				  ((uint64_t)u.seconds * 1000000000) + nanos);
+		failures += Check(batch_seq[i], u.loseq);
+	}
 
-uint8_t *uuid7_test_getrandom_bytes = NULL;
-size_t uuid7_test_getrandom_bytes_size = 0;
-ssize_t uuid7_test_getrandom_rv = 0;
-ssize_t uuid7_test_getrandom(void *buf, size_t bufz, unsigned int flags)
+	return failures;
+}
+
+/* the fewest and most hashes of any of 1024 buckets, of 10 bits at shift */
+static unsigned check_hash64_spread(const uint64_t *hashes, size_t count,
+				    unsigned shift)
 {
-	(void)flags;
+	unsigned failures = 0;
+	static uint32_t buckets[1024];
+	memset(buckets, 0x00, sizeof(buckets));
+	for (size_t i = 0; i < count; ++i) {
+		++buckets[(hashes[i] >> shift) & 1023];
+	}
+	/* 64 per bucket, thus within 6 standard deviations (8) of random */
+	uint32_t least = UINT32_MAX;
+	uint32_t most = 0;
+	for (size_t i = 0; i < 1024; ++i) {
+		least = buckets[i] < least ? buckets[i] : least;
+		most = buckets[i] > most ? buckets[i] : most;
+	}
+	if (least < 16 || most > 112) {
+		Fail("shift %u: least %u, most %u", shift, (unsigned)least,
+		     (unsigned)most);
+	}
+	return failures;
+}
 
-	if (uuid7_test_getrandom_rv < 0) {
-		return uuid7_test_getrandom_rv;
+unsigned check_hash64(void)
+{
+	unsigned failures = 0;
+	const uint8_t bytes[16] = {
+		0x01, 0x23, 0x45, 0x67,
+		0x89, 0xab, 0x7c, 0xde,
+		0x9f, 0x01, 0x23, 0x45,
+		0x67, 0x89, 0xab, 0xcd
+	};
+	failures += Check(uuid7_hash64(bytes), 0xffc778763c789d1e);
+
+	uint8_t other[16];
+	for (size_t i = 0; i < 16; ++i) {
+		memcpy(other, bytes, 16);
+		other[i] ^= 0x01;
+		if (uuid7_hash64(other) == uuid7_hash64(bytes)) {
+			Fail("a change of byte %zu is the same hash", i);
+		}
 	}
 
-	if (uuid7_test_getrandom_bytes && uuid7_test_getrandom_bytes_size) {
-		memcpy(buf, uuid7_test_getrandom_bytes,
-		       bufz < uuid7_test_getrandom_bytes_size
-		       ? bufz : uuid7_test_getrandom_bytes_size);
+	/* IDs of a batch, of each layout, spread as random */
+	const size_t count = 64 * 1024;
+	static uint8_t ids[64 * 1024 * 16];
+	static uint64_t hashes[64 * 1024];
+	struct uuid7_gen gen;
+	for (unsigned layout = 0; layout < 2; ++layout) {
+		uuid7_gen_init(&gen, NULL, 0);
+		uuid7_gen_policy(&gen, UUID7_POLICY_BORROW);
+		uuid7_gen_layout(&gen, layout);
+		failures += Check((intptr_t)uuid7_gen_n(&gen, ids, count),
+				  (intptr_t)ids);
+		uint64_t *rv = uuid7_hash64_n(hashes, ids, count);
+		failures += Check((intptr_t)rv, (intptr_t)hashes);
+		failures += Check(hashes[count - 1],
+				  uuid7_hash64(ids + (16 * (count - 1))));
+		for (unsigned shift = 0; shift <= 54; shift += 9) {
+			failures += check_hash64_spread(hashes, count, shift);
+		}
 	}
 
-	return uuid7_test_getrandom_rv;
+	/* and IDs which differ only in the sequence and random */
+	for (size_t i = 0; i < count; ++i) {
+		uuid7_pack(ids + (16 * i), (struct timespec) { 1, 0 },
+			   0x0000, (uint32_t)i);
+		ids[(16 * i) + 9] = (uint8_t)(i >> 8);
+	}
+	uuid7_hash64_n(hashes, ids, count);
+	for (unsigned shift = 0; shift <= 54; shift += 9) {
+		failures += check_hash64_spread(hashes, count, shift);
+	}
+
+	failures += Check((intptr_t)uuid7_hash64_n(NULL, NULL, 0),
+			  (intptr_t)NULL);
+
+	return failures;
 }
 
-unsigned check_bad_getrandom(void)
+unsigned check_time_range(void)
 {
 	unsigned failures = 0;
+	char buf[80];
+	uint8_t min[16];
+	uint8_t max[16];
+
+	struct timespec ts = { 0x123456789, 999999999 };
+	uuid7_min_for_time(min, ts, UUID7_LAYOUT_SECONDS);
+	uuid7_to_string(buf, sizeof(buf), min);
+	failures += Check_s(buf, "12345678-9ee6-7b27-7f00-000000000000");
+	uuid7_max_for_time(max, ts, UUID7_LAYOUT_SECONDS);
+	uuid7_to_string(buf, sizeof(buf), max);
+	failures += Check_s(buf, "12345678-9ee6-7b27-7fff-ffffffffffff");
+
+	ts.tv_sec = 1645557742;
+	ts.tv_nsec = 0;
+	uuid7_min_for_time(min, ts, UUID7_LAYOUT_RFC9562);
+	uuid7_to_string(buf, sizeof(buf), min);
+	failures += Check_s(buf, "017f22e2-79b0-7000-8000-000000000000");
+	uuid7_max_for_time(max, ts, UUID7_LAYOUT_RFC9562);
+	uuid7_to_string(buf, sizeof(buf), max);
+	failures += Check_s(buf, "017f22e2-79b0-7000-bfff-ffffffffffff");
+
+	/* ten UUIDs at each of 100 times, one microsecond apart */
+	uint8_t ids[1000 * 16];
+	for (size_t layout = 0; layout < 2; ++layout) {
+		for (size_t i = 0; i < 1000; ++i) {
+			uint8_t *id = ids + (16 * i);
+			ts.tv_nsec = 1000 * (i / 10);
+			uint32_t r = (uint32_t)(i * 2654435761U);
+			if (layout == UUID7_LAYOUT_RFC9562) {
+				uuid7_pack_rfc9562(id, ts, r >> 16, r);
+			} else {
+				uuid7_pack(id, ts, r >> 16, r);
+			}
+			id[9] = r >> 8;
+		}
+		uuid7_sort(ids, 1000);
+
+		struct timespec begin = { ts.tv_sec, 20 * 1000 };
+		struct timespec end = { ts.tv_sec, 49 * 1000 };
+		size_t first = 0;
+		size_t found = uuid7_time_range(ids, 1000, begin, end,
+						(unsigned)layout, &first);
+		failures += Check(first, 200);
+		failures += Check(found, 300);
+		for (size_t i = first; i < first + found; ++i) {
+			/* of RFC 9562, the start of the 1/4096 ms */
+			uint64_t ns = uuid7_timestamp_ns(ids + (16 * i));
+			uint64_t second = 1645557742ULL * 1000000000;
+			failures += Check((ns > second + (19 * 1000) + 500
+					   && ns <= second + (49 * 1000)), 1);
+		}
 
-	ssize_t (*orig_getrandom)(void *buf, size_t buflen, unsigned int flags)
-	    = uuid7_getrandom;
+		/* before and after all */
+		begin.tv_nsec = 0;
+		end.tv_nsec = 999999999;
+		failures += Check(uuid7_time_range(ids, 1000, begin, end,
+						   (unsigned)layout, NULL),
+				  1000);
+		begin.tv_sec = 0;
+		end.tv_sec = 1;
+		failures += Check(uuid7_time_range(ids, 1000, begin, end,
+						   (unsigned)layout, &first),
+				  0);
+		failures += Check(first, 0);
+	}
 
-	uuid7_getrandom = uuid7_test_getrandom;
-	uuid7_test_getrandom_rv = -1;
+	/* bounds of an exact key, of the empty array */
+	failures += Check(uuid7_lower_bound(ids, 1000, ids + (16 * 500)), 500);
+	failures += Check(uuid7_upper_bound(ids, 1000, ids + (16 * 500)), 501);
+	failures += Check(uuid7_lower_bound(ids, 0, ids), 0);
+
+	return failures;
+}
 
+static unsigned check_base32_simd(void)
+{
+	unsigned failures = 0;
+	const uint8_t bytes[16] = {
+		0x01, 0x23, 0x45, 0x67,
+		0x89, 0xab, 0x7c, 0xde,
+		0x5f, 0x01, 0x23, 0x45,
+		0x67, 0x89, 0xab, 0xcd
+	};
+	const char *expect = "014D2PF2DBFKF5Y0938NKRKAYD";
+	const uint8_t zeros[16] = { 0 };
+	char buf[40];
 	uint8_t ubuf[16];
-	memset(ubuf, '?', sizeof(ubuf));
 
-	uint8_t *rv = uuid7(ubuf);
+	memset(buf, '?', sizeof(buf));
+	failures += Check((intptr_t)uuid7_to_base32(buf, 26, bytes),
+			  (intptr_t)NULL);
+	failures += Check_s(buf, "");
+
+	char *rv = uuid7_to_base32(buf, 27, bytes);
+	failures += Check((intptr_t)rv, (intptr_t)buf);
+	failures += Check_s(buf, expect);
+
+	uint8_t *urv = uuid7_from_base32(ubuf, expect, 26);
+	failures += Check((intptr_t)urv, (intptr_t)ubuf);
+	failures += Check(memcmp(ubuf, bytes, 16), 0);
+
+	/* lower case, and I, L, O read as 1, 1, 0 */
+	memset(ubuf, 0x00, 16);
+	urv = uuid7_from_base32(ubuf, "oi4d2pf2dbfkf5yo938nkrkayd", 26);
+	failures += Check((intptr_t)urv, (intptr_t)ubuf);
+	failures += Check(memcmp(ubuf, bytes, 16), 0);
+	urv = uuid7_from_base32(ubuf, "0L4D2PF2DBFKF5Y0938NKRKAYD", 26);
+	failures += Check((intptr_t)urv, (intptr_t)ubuf);
+	failures += Check(memcmp(ubuf, bytes, 16), 0);
+
+	/* too long, too short, and more than 128 bits */
+	urv = uuid7_from_base32(ubuf, expect, 25);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+	failures += Check(memcmp(ubuf, zeros, 16), 0);
+	urv = uuid7_from_base32(ubuf, "814D2PF2DBFKF5Y0938NKRKAYD", 26);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+
+	/* not digits, and not a version 7 */
+	const char not_digit[] = { '/', ':', '@', 'U', 'u', '[', '\x80' };
+	for (size_t i = 0; i < 26; ++i) {
+		for (size_t j = 0; j < sizeof(not_digit); ++j) {
+			char str[27];
+			memcpy(str, expect, 27);
+			str[i] = not_digit[j];
+			urv = uuid7_from_base32(ubuf, str, 26);
+			failures += Check((intptr_t)urv, (intptr_t)NULL);
+		}
+	}
+	uint8_t v4[16];
+	memcpy(v4, bytes, 16);
+	v4[6] = 0x4c;
+	uuid7_to_base32(buf, sizeof(buf), v4);
+	urv = uuid7_from_base32(ubuf, buf, 26);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+	failures += Check(memcmp(ubuf, zeros, 16), 0);
+
+	/* the strings sort as the UUIDs sort, and survive the round trip */
+	const size_t count = 256;
+	uint8_t ids[256 * 16];
+	char strs[256 * 27];
+	uint8_t parsed[256 * 16];
+	failures += Check((intptr_t)uuid7_n(ids, count), (intptr_t)ids);
+	for (size_t i = 0; i < sizeof(ids); ++i) {
+		if ((i % 16) > 9) {
+			ids[i] = (uint8_t)(i * 37);
+		}
+	}
+	uuid7_test_shuffle(ids, count);
+	rv = uuid7_to_base32_n(strs, sizeof(strs), ids, count, 27);
+	failures += Check((intptr_t)rv, (intptr_t)strs);
+	for (size_t i = 0; i < count; ++i) {
+		char one[27];
+		uuid7_to_base32(one, sizeof(one), ids + (i * 16));
+		failures += Check_s(strs + (i * 27), one);
+		if (i) {
+			int by_id = memcmp(ids + ((i - 1) * 16), ids + (i * 16),
+					   16);
+			int by_str = strcmp(strs + ((i - 1) * 27),
+					    strs + (i * 27));
+			failures += Check(uuid7_test_sign(by_str),
+					  uuid7_test_sign(by_id));
+		}
+	}
+	urv = uuid7_from_base32_n(parsed, strs, count, 27);
+	failures += Check((intptr_t)urv, (intptr_t)parsed);
+	failures += Check(memcmp(parsed, ids, sizeof(ids)), 0);
+
+	/* back to back, and one bad entry is zeroed */
+	char packed[256 * 26];
+	rv = uuid7_to_base32_n(packed, sizeof(packed), ids, count, 26);
+	failures += Check((intptr_t)rv, (intptr_t)packed);
+	failures += Check(memcmp(packed, strs, 26), 0);
+	packed[(3 * 26) + 5] = 'U';
+	urv = uuid7_from_base32_n(parsed, packed, count, 26);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+	failures += Check(memcmp(parsed + (3 * 16), zeros, 16), 0);
+	failures += Check(memcmp(parsed, ids, 3 * 16), 0);
+
+	return failures;
+}
+
+unsigned check_base32(void)
+{
+	unsigned failures = 0;
+
+	for (int simd = 1; simd >= 0; --simd) {
+		uuid7_hex_simd = simd;
+		failures += check_base32_simd();
+	}
+	uuid7_hex_simd = 1;
+
+	uint8_t ids[2 * 16] = { 0 };
+	char out[2 * 27];
+	memset(out, '?', sizeof(out));
+	char *rv = uuid7_to_base32_n(out, sizeof(out) - 1, ids, 2, 27);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check(out[0], '\0');
+	failures += Check(out[sizeof(out) - 1], '?');
+	rv = uuid7_to_base32_n(out, sizeof(out), ids, 2, 28);
 	failures += Check((intptr_t)rv, (intptr_t)NULL);
 
-	uuid7_getrandom = orig_getrandom;
+	uint8_t parsed[2 * 16];
+	memset(out, '0', sizeof(out));
+	memset(parsed, '?', sizeof(parsed));
+	uint8_t *urv = uuid7_from_base32_n(parsed, out, 2, 25);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+	failures += Check(parsed[(2 * 16) - 1], 0);
+	urv = uuid7_from_base32_n(parsed, out, SIZE_MAX, 26);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
 
 	return failures;
 }
 
-int main(void)
+static unsigned check_base64url_simd(void)
 {
 	unsigned failures = 0;
+	const uint8_t bytes[16] = {
+		0x01, 0x23, 0x45, 0x67,
+		0x89, 0xab, 0x7c, 0xde,
+		0x5f, 0x01, 0x23, 0x45,
+		0x67, 0x89, 0xab, 0xcd
+	};
+	const uint8_t ones[16] = {
+		0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0x7f, 0xff,
+		0xbf, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff
+	};
+	const char *expect = "ASNFZ4mrfN5fASNFZ4mrzQ";
+	const char *expect_ones = "________f_-__________w";
+	const uint8_t zeros[16] = { 0 };
+	char buf[40];
+	uint8_t ubuf[16];
 
-#ifdef UUID7_WITH_MUTEX
-	uuid7_mutex_init();
-#endif
+	memset(buf, '?', sizeof(buf));
+	failures += Check((intptr_t)uuid7_to_base64url(buf, 22, bytes),
+			  (intptr_t)NULL);
+	failures += Check_s(buf, "");
 
-	failures += check_sortable();
-	failures += check_parts();
-	failures += check_to_string();
-	failures += check_bad_clock_id();
-	failures += check_bad_gettime();
-	failures += check_bad_getrandom();
-	failures += check_backwards_in_time();
+	char *rv = uuid7_to_base64url(buf, 23, bytes);
+	failures += Check((intptr_t)rv, (intptr_t)buf);
+	failures += Check_s(buf, expect);
+	uuid7_to_base64url(buf, sizeof(buf), ones);
+	failures += Check_s(buf, expect_ones);
+
+	uint8_t *urv = uuid7_from_base64url(ubuf, expect, 22);
+	failures += Check((intptr_t)urv, (intptr_t)ubuf);
+	failures += Check(memcmp(ubuf, bytes, 16), 0);
+	urv = uuid7_from_base64url(ubuf, expect_ones, 22);
+	failures += Check((intptr_t)urv, (intptr_t)ubuf);
+	failures += Check(memcmp(ubuf, ones, 16), 0);
+
+	/* too short, and bits past the 128th */
+	urv = uuid7_from_base64url(ubuf, expect, 21);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+	failures += Check(memcmp(ubuf, zeros, 16), 0);
+	urv = uuid7_from_base64url(ubuf, "ASNFZ4mrfN5fASNFZ4mrzR", 22);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+
+	/* not digits, including padding, and not a version 7 */
+	const char not_digit[] = { '+', '/', '=', '.', '@', '`', '\x80' };
+	for (size_t i = 0; i < 22; ++i) {
+		for (size_t j = 0; j < sizeof(not_digit); ++j) {
+			char str[23];
+			memcpy(str, expect, 23);
+			str[i] = not_digit[j];
+			urv = uuid7_from_base64url(ubuf, str, 22);
+			failures += Check((intptr_t)urv, (intptr_t)NULL);
+		}
+	}
+	uint8_t v4[16];
+	memcpy(v4, bytes, 16);
+	v4[6] = 0x4c;
+	uuid7_to_base64url(buf, sizeof(buf), v4);
+	urv = uuid7_from_base64url(ubuf, buf, 22);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+	failures += Check(memcmp(ubuf, zeros, 16), 0);
+
+	/* generated ones survive the round trip */
+	const size_t count = 64;
+	uint8_t ids[64 * 16];
+	char strs[64 * 23];
+	uint8_t parsed[64 * 16];
+	failures += Check((intptr_t)uuid7_n(ids, count), (intptr_t)ids);
+	rv = uuid7_to_base64url_n(strs, sizeof(strs), ids, count, 23);
+	failures += Check((intptr_t)rv, (intptr_t)strs);
+	for (size_t i = 0; i < count; ++i) {
+		char one[23];
+		uuid7_to_base64url(one, sizeof(one), ids + (i * 16));
+		failures += Check_s(strs + (i * 23), one);
+	}
+	urv = uuid7_from_base64url_n(parsed, strs, count, 23);
+	failures += Check((intptr_t)urv, (intptr_t)parsed);
+	failures += Check(memcmp(parsed, ids, sizeof(ids)), 0);
+
+	/* back to back, and one bad entry is zeroed */
+	char packed[64 * 22];
+	rv = uuid7_to_base64url_n(packed, sizeof(packed), ids, count, 22);
+	failures += Check((intptr_t)rv, (intptr_t)packed);
+	failures += Check(memcmp(packed, strs, 22), 0);
+	packed[(3 * 22) + 5] = '=';
+	urv = uuid7_from_base64url_n(parsed, packed, count, 22);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+	failures += Check(memcmp(parsed + (3 * 16), zeros, 16), 0);
+	failures += Check(memcmp(parsed, ids, 3 * 16), 0);
+
+	return failures;
+}
+
+unsigned check_base64url(void)
+{
+	unsigned failures = 0;
+
+	for (int simd = 1; simd >= 0; --simd) {
+		uuid7_hex_simd = simd;
+		failures += check_base64url_simd();
+	}
+	uuid7_hex_simd = 1;
+
+	uint8_t ids[2 * 16] = { 0 };
+	char out[2 * 23];
+	memset(out, '?', sizeof(out));
+	char *rv = uuid7_to_base64url_n(out, sizeof(out) - 1, ids, 2, 23);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check(out[0], '\0');
+	failures += Check(out[sizeof(out) - 1], '?');
+	rv = uuid7_to_base64url_n(out, sizeof(out), ids, SIZE_MAX, 22);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uint8_t parsed[2 * 16];
+	memset(out, 'A', sizeof(out));
+	memset(parsed, '?', sizeof(parsed));
+	uint8_t *urv = uuid7_from_base64url_n(parsed, out, 2, 21);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+	failures += Check(parsed[(2 * 16) - 1], 0);
+	urv = uuid7_from_base64url_n(parsed, out, SIZE_MAX, 22);
+	failures += Check((intptr_t)urv, (intptr_t)NULL);
+
+	return failures;
+}
+
+static unsigned check_validate_simd(void)
+{
+	unsigned failures = 0;
+	const size_t count = 101;
+	static uint8_t ids[101 * 16];
+	uint8_t ok[101];
+	uint8_t expect[101];
+	struct uuid7_gen gen;
+
+	/* generated ones, of either layout, are valid in the window of now */
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	uint64_t now_ns = ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+	uint64_t hour_ns = (uint64_t)3600 * 1000000000;
+	for (size_t i = 0; i < count; ++i) {
+		uuid7_gen_init(&gen, NULL, 0);
+		uuid7_gen_layout(&gen, (unsigned)(i % 2));
+		failures += Check((intptr_t)uuid7_gen_next(&gen, ids + (16 * i)),
+				  (intptr_t)(ids + (16 * i)));
+	}
+	memset(ok, 0xFF, sizeof(ok));
+	size_t valid = uuid7_validate_n(ids, count, ok, now_ns - hour_ns,
+					now_ns + hour_ns);
+	failures += Check(valid, count);
+	for (size_t i = 0; i < count; ++i) {
+		failures += Check(ok[i], 1);
+	}
+
+	/* break some: version, each bad variant, too old, and too new */
+	memset(expect, 1, sizeof(expect));
+	for (size_t i = 0; i < count; i += 3) {
+		uint8_t *id = ids + (16 * i);
+		switch ((i / 3) % 5) {
+		case 0:
+			id[6] = (uint8_t)((id[6] & 0x0F) | 0x40);
+			break;
+		case 1:
+			id[8] &= 0x3F;
+			break;
+		case 2:
+			id[8] |= 0xC0;
+			break;
+		case 3:
+			uuid7_pack(id, (struct timespec) { 1, 0 }, 0, 0);
+			break;
+		default:
+			uuid7_pack(id, (struct timespec) {
+				   now.tv_sec + (2 * 3600), 0 }, 0, 0);
+			break;
+		}
+		expect[i] = 0;
+	}
+	valid = uuid7_validate_n(ids, count, ok, now_ns - hour_ns,
+				 now_ns + hour_ns);
+	failures += Check(valid, count - ((count + 2) / 3));
+	failures += Check(memcmp(ok, expect, count), 0);
+
+	/* without a window, only the version and variant are checked */
+	valid = uuid7_validate_n(ids, count, ok, 0, UINT64_MAX);
+	failures += Check(ok[9], 1);
+	failures += Check(ok[12], 1);
+	failures += Check(ok[0], 0);
+	failures += Check(valid, count - (3 * ((count + 14) / 15)));
+
+	/* the window is inclusive of both ends */
+	struct timespec ts = { 1000, 500 };
+	uuid7_pack(ids, ts, 0xFFFF, 0xFFFFFFFF);
+	uuid7_pack_rfc9562(ids + 16, ts, 0x0000, 0x00000000);
+	uint64_t ts_ns = (1000 * (uint64_t)1000000000) + 500;
+	failures += Check(uuid7_validate_n(ids, 2, ok, ts_ns, ts_ns), 2);
+	failures += Check(uuid7_validate_n(ids, 2, ok, ts_ns + 1000000,
+					   UINT64_MAX), 0);
+	failures += Check(uuid7_validate_n(ids, 2, ok, 0, ts_ns - 1000000),
+			  0);
+	failures += Check(uuid7_validate_n(ids, 0, ok, 0, UINT64_MAX), 0);
+
+	return failures;
+}
+
+unsigned check_validate(void)
+{
+	unsigned failures = 0;
+
+	for (int simd = 1; simd >= 0; --simd) {
+		uuid7_hex_simd = simd;
+		failures += check_validate_simd();
+	}
+	uuid7_hex_simd = 1;
+
+	return failures;
+}
+
+/* global variable defined in uuid7.c, but not exposed in uuid7.h */
+extern clockid_t uuid7_clockid;
+
+unsigned check_bad_clock_id(void)
+{
+	unsigned failures = 0;
+
+	clockid_t orig_clockid = uuid7_clockid;
+	uuid7_clockid = 1234567;	/* assumed to be bogus */
+
+	uint8_t ubuf[16];
+	memset(ubuf, '?', sizeof(ubuf));
+
+	uint8_t *rv = uuid7(ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_clockid = orig_clockid;
+
+	return failures;
+}
+
+/* friend function defined in uui7.c, but not exposed in uuid7.h */
+extern int (*uuid7_clock_gettime)(clockid_t clockid, struct timespec *tp);
+
+time_t uuid7_test_bogus_clock_sec = 0;
+long uuid7_test_bogus_clock_nsec = 0;
+int uuid7_test_bogus_clock_rv = 0;
+int uuid7_test_bogus_clock_gettime(clockid_t clockid, struct timespec *tp)
+{
+	(void)clockid;
+
+	if (tp) {
+		tp->tv_sec = uuid7_test_bogus_clock_sec;
+		tp->tv_nsec = uuid7_test_bogus_clock_nsec;
+	}
+
+	return uuid7_test_bogus_clock_rv;
+}
+
+void uuid7_reset(void);
+
+unsigned check_bad_gettime(void)
+{
+	unsigned failures = 0;
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_rv = 1;
+
+	uint8_t ubuf[16];
+	memset(ubuf, '?', sizeof(ubuf));
+
+	uint8_t *rv = uuid7(ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_clock_gettime = orig_gettime;
+
+	uuid7_reset();
+
+	return failures;
+}
+
+unsigned check_backwards_in_time(void)
+{
+	unsigned failures = 0;
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 102556800;
+	uuid7_test_bogus_clock_nsec = 0;
+	uuid7_test_bogus_clock_rv = 0;
+
+	uint8_t ubuf[16];
+	memset(ubuf, '?', sizeof(ubuf));
+
+	uint8_t *rv = uuid7(ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+
+	/* set the clock backwards in time: */
+	uuid7_test_bogus_clock_sec -= 1;
+
+	rv = uuid7(ubuf);
+#ifdef UUID7_NEVER_FAIL
+	/* borrowed from the last issued */
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	struct uuid7 u;
+	uuid7_parts(&u, ubuf);
+	failures += Check(u.seconds, uuid7_test_bogus_clock_sec + 1);
+	failures += Check(u.loseq, 1);
+#else
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+#endif
+
+	/* the clock catches back up: */
+	uuid7_test_bogus_clock_sec += 1;
+
+	rv = uuid7(ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+
+	/* set the clock very far backwards in time: */
+	uuid7_test_bogus_clock_sec = 7776000;
+
+	rv = uuid7(ubuf);
+#ifdef UUID7_NEVER_FAIL
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+#else
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+#endif
+
+	/* very "chummy" with the library, call reset(): */
+	uuid7_reset();
+
+	rv = uuid7(ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+
+	uuid7_clock_gettime = orig_gettime;
+
+	uuid7_reset();
+
+	return failures;
+}
+
+#ifndef UUID7_NO_THREADS
+#include <stdatomic.h>
+/* 1 once the thread has issued a UUID, 2 once reset, 3 once again */
+static _Atomic int uuid7_test_reset_phase = 0;
+static int uuid7_test_reset_thread_func(void *context)
+{
+	uint8_t *ubuf = (uint8_t *)context;
+	uuid7(ubuf);
+	atomic_store(&uuid7_test_reset_phase, 1);
+	while (atomic_load(&uuid7_test_reset_phase) != 2) {
+		thrd_yield();
+	}
+	uuid7(ubuf + 16);
+	atomic_store(&uuid7_test_reset_phase, 3);
+	return 0;
+}
+#endif
+
+unsigned check_reset_all(void)
+{
+	unsigned failures = 0;
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 102556800;
+	uuid7_test_bogus_clock_nsec = 0;
+	uuid7_test_bogus_clock_rv = 0;
+
+	uint8_t ubuf[16];
+	struct uuid7 u;
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+	failures += Check((intptr_t)uuid7(ubuf), (intptr_t)ubuf);
+	failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf), (intptr_t)ubuf);
+
+	/* far back in time, the state of the thread and of gen are reset */
+	uuid7_test_bogus_clock_sec = 7776000;
+	uuid7_reset_all();
+	failures += Check((intptr_t)uuid7(ubuf), (intptr_t)ubuf);
+	uuid7_parts(&u, ubuf);
+	failures += Check(u.seconds, 7776000);
+	failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf), (intptr_t)ubuf);
+	uuid7_parts(&u, ubuf);
+	failures += Check(u.seconds, 7776000);
+
+	/* and of a batch */
+	uint8_t ids[4 * 16];
+	uuid7_test_bogus_clock_sec = 102556800;
+	failures += Check((intptr_t)uuid7_n(ids, 4), (intptr_t)ids);
+	failures += Check((intptr_t)uuid7_gen_n(&gen, ids, 4), (intptr_t)ids);
+	uuid7_test_bogus_clock_sec = 7776000;
+	uuid7_reset_all();
+	failures += Check((intptr_t)uuid7_n(ids, 4), (intptr_t)ids);
+	uuid7_parts(&u, ids + (3 * 16));
+	failures += Check(u.seconds, 7776000);
+	failures += Check((intptr_t)uuid7_gen_n(&gen, ids, 4), (intptr_t)ids);
+	uuid7_parts(&u, ids + (3 * 16));
+	failures += Check(u.seconds, 7776000);
+
+#ifndef UUID7_NO_THREADS
+	/* of another thread, which has already issued a UUID */
+	uint8_t theirs[2 * 16];
+	thrd_t thread;
+	uuid7_test_bogus_clock_sec = 102556800;
+	atomic_store(&uuid7_test_reset_phase, 0);
+	failures += Check(thrd_create(&thread, uuid7_test_reset_thread_func,
+				      theirs), thrd_success);
+	while (atomic_load(&uuid7_test_reset_phase) != 1) {
+		thrd_yield();
+	}
+	uuid7_test_bogus_clock_sec = 7776000;
+	uuid7_reset_all();
+	atomic_store(&uuid7_test_reset_phase, 2);
+	thrd_join(thread, NULL);
+	failures += Check(atomic_load(&uuid7_test_reset_phase), 3);
+	failures += Check((intptr_t)uuid7_parts(&u, theirs + 16),
+			  (intptr_t)&u);
+	failures += Check(u.seconds, 7776000);
+#endif
+
+	uuid7_clock_gettime = orig_gettime;
+	uuid7_reset_all();
+
+	return failures;
+}
+
+/* friend function defined in uui7.c, but not exposed in uuid7.h */
+extern ssize_t (*uuid7_getrandom)(void *buf, size_t buflen, unsigned int flags);
+
+uint8_t *uuid7_test_getrandom_bytes = NULL;
+size_t uuid7_test_getrandom_bytes_size = 0;
+ssize_t uuid7_test_getrandom_rv = 0;
+ssize_t uuid7_test_getrandom(void *buf, size_t bufz, unsigned int flags)
+{
+	(void)flags;
+
+	if (uuid7_test_getrandom_rv < 0) {
+		return uuid7_test_getrandom_rv;
+	}
+
+	if (uuid7_test_getrandom_bytes && uuid7_test_getrandom_bytes_size) {
+		memcpy(buf, uuid7_test_getrandom_bytes,
+		       bufz < uuid7_test_getrandom_bytes_size
+		       ? bufz : uuid7_test_getrandom_bytes_size);
+	}
+
+	return uuid7_test_getrandom_rv;
+}
+
+unsigned check_bad_getrandom(void)
+{
+	unsigned failures = 0;
+
+	ssize_t (*orig_getrandom)(void *buf, size_t buflen, unsigned int flags)
+	    = uuid7_getrandom;
+
+	uuid7_getrandom = uuid7_test_getrandom;
+	uuid7_test_getrandom_rv = -1;
+#ifdef UUID7_ENTROPY_POOL
+	uuid7_entropy_reset();
+#endif
+
+	uint8_t ubuf[16];
+	memset(ubuf, '?', sizeof(ubuf));
+
+	uint8_t *rv = uuid7(ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_getrandom = orig_getrandom;
+
+	return failures;
+}
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+ssize_t (*uuid7_test_getrandom_orig)(void *buf, size_t buflen,
+				     unsigned int flags) = NULL;
+size_t uuid7_test_getrandom_calls = 0;
+ssize_t uuid7_test_getrandom_counting(void *buf, size_t bufz,
+				      unsigned int flags)
+{
+	++uuid7_test_getrandom_calls;
+	return uuid7_test_getrandom_orig(buf, bufz, flags);
+}
+
+unsigned check_gen(void)
+{
+	unsigned failures = 0;
+
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+	failures += Check(((uintptr_t)&gen) % UUID7_CACHE_LINE, 0);
+	/* thus generators side by side never share a line */
+	failures += Check(sizeof(struct uuid7_gen) % UUID7_CACHE_LINE, 0);
+
+	size_t uuids_len = 300;
+	uint8_t uuid7s[300][16];
+	struct uuid7 u;
+	uint16_t segment = 0;
+	for (size_t i = 0; i < uuids_len; ++i) {
+		while (!uuid7_gen_next(&gen, uuid7s[i])) ;
+		failures += Check((uuid7_parts(&u, uuid7s[i]) != NULL), 1);
+		if (i == 0) {
+			segment = u.segment;
+		} else {
+			int cmp = memcmp(uuid7s[i - 1], uuid7s[i], 16);
+			failures += Check((cmp < 0), 1);
+		}
+		failures += Check(u.segment, segment);
+	}
+
+	uint8_t *rv = uuid7_gen_n(&gen, uuid7s[0], uuids_len);
+	failures += Check((intptr_t)rv, (intptr_t)uuid7s[0]);
+	for (size_t i = 0; i < uuids_len; ++i) {
+		failures += Check((uuid7_parts(&u, uuid7s[i]) != NULL), 1);
+		failures += Check(u.segment, segment);
+		if (i > 0) {
+			int cmp = memcmp(uuid7s[i - 1], uuid7s[i], 16);
+			failures += Check((cmp < 0), 1);
+		}
+	}
+
+	rv = uuid7_gen_n(&gen, uuid7s[0], SIZE_MAX);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	/* a generator is its own stream, unaffected by others */
+	struct uuid7_gen other;
+	uuid7_gen_init(&other, NULL, 0);
+	while (!uuid7_gen_next(&other, uuid7s[0])) ;
+	uuid7_parts(&u, uuid7s[0]);
+	failures += Check((u.segment != segment), 1);
+
+	return failures;
+}
+
+unsigned check_segment(void)
+{
+	unsigned failures = 0;
+
+	uint8_t uuid7s[300][16];
+	struct uuid7 u;
+
+	failures += Check(uuid7_set_segment(0x1234, 16), 0);
+	while (!uuid7(uuid7s[0])) ;
+	uuid7_parts(&u, uuid7s[0]);
+	failures += Check(u.segment, 0x1234);
+	while (!uuid7_n(uuid7s[0], 300)) ;
+	for (size_t i = 0; i < 300; ++i) {
+		uuid7_parts(&u, uuid7s[i]);
+		failures += Check(u.segment, 0x1234);
+	}
+
+	/* a generator takes the segment at init, unless given its own */
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+	while (!uuid7_gen_next(&gen, uuid7s[0])) ;
+	uuid7_parts(&u, uuid7s[0]);
+	failures += Check(u.segment, 0x1234);
+	uuid7_gen_segment(&gen, 0xBEEF);
+	while (!uuid7_gen_n(&gen, uuid7s[0], 300)) ;
+	for (size_t i = 0; i < 300; ++i) {
+		uuid7_parts(&u, uuid7s[i]);
+		failures += Check(u.segment, 0xBEEF);
+	}
+
+	/* the high 9 bits are the node, the rest are as before */
+	failures += Check(uuid7_set_segment(400, 9), 0);
+	while (!uuid7_n(uuid7s[0], 300)) ;
+	for (size_t i = 0; i < 300; ++i) {
+		uuid7_parts(&u, uuid7s[i]);
+		failures += Check(u.segment >> 7, 400);
+	}
+
+	failures += Check(uuid7_set_segment(512, 9), -1);
+	failures += Check(uuid7_set_segment(1, 17), -1);
+	failures += Check(uuid7_set_segment(1, 0), -1);
+
+	unsetenv("UUID7_SEGMENT");
+	failures += Check(uuid7_set_segment_env(), 0);
+	setenv("UUID7_SEGMENT", "", 1);
+	failures += Check(uuid7_set_segment_env(), 0);
+	setenv("UUID7_SEGMENT", "0xCAFE", 1);
+	failures += Check(uuid7_set_segment_env(), 1);
+	while (!uuid7(uuid7s[0])) ;
+	uuid7_parts(&u, uuid7s[0]);
+	failures += Check(u.segment, 0xCAFE);
+	setenv("UUID7_SEGMENT", "5/3", 1);
+	failures += Check(uuid7_set_segment_env(), 1);
+	while (!uuid7(uuid7s[0])) ;
+	uuid7_parts(&u, uuid7s[0]);
+	failures += Check(u.segment >> 13, 5);
+
+	const char *invalid[] = { "node", "/3", "5/", "5/3x", "5/17", "9/3",
+		"65536", "-1", "99999999999999999999999"
+	};
+	for (size_t i = 0; i < (sizeof(invalid) / sizeof(invalid[0])); ++i) {
+		setenv("UUID7_SEGMENT", invalid[i], 1);
+		failures += Check(uuid7_set_segment_env(), -1);
+	}
+	/* left as it was */
+	while (!uuid7(uuid7s[0])) ;
+	uuid7_parts(&u, uuid7s[0]);
+	failures += Check(u.segment >> 13, 5);
+
+	unsetenv("UUID7_SEGMENT");
+	failures += Check(uuid7_set_segment(0, 0), 0);
+
+	return failures;
+}
+
+unsigned check_gen_failures(void)
+{
+	unsigned failures = 0;
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	ssize_t (*orig_getrandom)(void *buf, size_t buflen, unsigned int flags)
+	    = uuid7_getrandom;
+
+	uint8_t entropy[64];
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, entropy, sizeof(entropy));
+
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 102556800;
+	uuid7_test_bogus_clock_nsec = 0;
+	uuid7_test_bogus_clock_rv = 0;
+
+	uint8_t ubuf[16];
+	uint8_t *rv = uuid7_gen_next(&gen, ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+
+	/* set the clock backwards in time: */
+	uuid7_test_bogus_clock_sec -= 1;
+	rv = uuid7_gen_next(&gen, ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check_s((const char *)ubuf, "");
+
+	uint8_t uuid7s[2][16];
+	rv = uuid7_gen_n(&gen, uuid7s[0], 2);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_gen_reset(&gen);
+	rv = uuid7_gen_next(&gen, ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+
+	uuid7_test_bogus_clock_rv = 1;
+	rv = uuid7_gen_next(&gen, ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	rv = uuid7_gen_n(&gen, uuid7s[0], 2);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_clock_gettime = orig_gettime;
+
+	uuid7_getrandom = uuid7_test_getrandom;
+	uuid7_test_getrandom_rv = -1;
+
+	/* a buffer too small to be useful is not used */
+	struct uuid7_gen unbuffered;
+	uuid7_gen_init(&unbuffered, entropy, 2);
+	rv = uuid7_gen_next(&unbuffered, ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	/* the initial buffer is empty, and can not be filled */
+	uuid7_gen_init(&gen, entropy, sizeof(entropy));
+	rv = uuid7_gen_next(&gen, ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_test_getrandom_rv = 0;
+	uuid7_getrandom = orig_getrandom;
+
+	return failures;
+}
+
+static unsigned check_gen_borrow_after(struct uuid7_gen *gen, uint8_t *prev,
+				       size_t count)
+{
+	unsigned failures = 0;
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t ubuf[16];
+		uint8_t *rv = uuid7_gen_next(gen, ubuf);
+		failures += Check((intptr_t)rv, (intptr_t)ubuf);
+		failures += Check((memcmp(prev, ubuf, 10) < 0), 1);
+		memcpy(prev, ubuf, 16);
+	}
+	return failures;
+}
+
+unsigned check_gen_borrow(void)
+{
+	unsigned failures = 0;
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	ssize_t (*orig_getrandom)(void *buf, size_t buflen, unsigned int flags)
+	    = uuid7_getrandom;
+
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 102556800;
+	uuid7_test_bogus_clock_nsec = 999999999;
+	uuid7_test_bogus_clock_rv = 0;
+
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+	uuid7_gen_policy(&gen, UUID7_POLICY_BORROW);
+
+	uint8_t prev[16];
+	uint8_t *rv = uuid7_gen_next(&gen, prev);
+	failures += Check((intptr_t)rv, (intptr_t)prev);
+
+	/* backwards: borrow 255 sequence numbers, then the next nanosecond */
+	uuid7_test_bogus_clock_sec -= 1;
+	failures += check_gen_borrow_after(&gen, prev, 300);
+
+	struct uuid7 u;
+	uuid7_parts(&u, prev);
+	failures += Check(u.seconds, 102556801);
+	failures += Check(uuid7_nanos(u), 0);
+	failures += Check(u.loseq, 300 - 256);
+
+	uint8_t batch[300 * 16];
+	rv = uuid7_gen_n(&gen, batch, 300);
+	failures += Check((intptr_t)rv, (intptr_t)batch);
+	for (size_t i = 0; i < 300; ++i) {
+		failures += Check((memcmp(prev, batch + (i * 16), 10) < 0), 1);
+		memcpy(prev, batch + (i * 16), 16);
+	}
+
+	uint8_t ubuf[16];
+	uuid7_gen_policy(&gen, UUID7_POLICY_FAIL);
+	rv = uuid7_gen_next(&gen, ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	rv = uuid7_gen_n(&gen, batch, 1);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	/* the sequence used up, with random bytes which do not sort */
+	uint8_t zeros[4] = { 0, 0, 0, 0 };
+	uuid7_getrandom = uuid7_test_getrandom;
+	uuid7_test_getrandom_bytes = zeros;
+	uuid7_test_getrandom_bytes_size = sizeof(zeros);
+	uuid7_test_getrandom_rv = sizeof(zeros);
+	uuid7_test_bogus_clock_sec = 102556900;
+	uuid7_test_bogus_clock_nsec = 0;
+
+	uuid7_gen_reset(&gen);
+	memset(prev, 0x00, 16);
+	failures += check_gen_borrow_after(&gen, prev, 256);
+	rv = uuid7_gen_next(&gen, ubuf);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_gen_policy(&gen, UUID7_POLICY_BORROW);
+	failures += check_gen_borrow_after(&gen, prev, 1);
+	uuid7_parts(&u, prev);
+	failures += Check(u.seconds, 102556900);
+	failures += Check(uuid7_nanos(u), 1);
+	failures += Check(u.loseq, 0);
+
+	uuid7_test_getrandom_bytes = NULL;
+	uuid7_test_getrandom_bytes_size = 0;
+	uuid7_test_getrandom_rv = 0;
+	uuid7_getrandom = orig_getrandom;
+	uuid7_clock_gettime = orig_gettime;
+
+	return failures;
+}
+
+static uint16_t uuid7_test_counter(const uint8_t *bytes)
+{
+	return (((uint16_t)(bytes[8] & 0x3F)) << 8) | bytes[9];
+}
+
+unsigned check_rfc9562(void)
+{
+	unsigned failures = 0;
+
+	/* the unix_ts_ms of the example of RFC 9562, appendix A.6 */
+	struct timespec ts = { 1645557742, 0 };
+	uint8_t ubuf[16];
+	char buf[80];
+	uint8_t *rv = uuid7_pack_rfc9562(ubuf, ts, 0x0102, 0x04030201);
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	uuid7_to_string(buf, sizeof(buf), ubuf);
+	failures += Check_s(buf, "017f22e2-79b0-7000-8000-010201020304");
+
+	/* half a millisecond is 2048 of 4096 */
+	ts.tv_nsec = 500000;
+	uuid7_pack_rfc9562(ubuf, ts, 0x0102, 0x04030201);
+	uuid7_to_string(buf, sizeof(buf), ubuf);
+	failures += Check_s(buf, "017f22e2-79b0-7800-8000-010201020304");
+
+	struct uuid7 u;
+	ts.tv_nsec = 999999999;
+	uuid7_pack_rfc9562(ubuf, ts, 0x0102, 0x04030201);
+	failures += Check((intptr_t)uuid7_parts(&u, ubuf), (intptr_t)&u);
+	failures += Check(u.uuid_ver, UUID7_VERSION);
+	failures += Check(u.uuid_var, UUID7_VARIANT_RFC9562);
+	failures += Check(u.seconds, ts.tv_sec);
+	failures += Check((uuid7_nanos(u) >= 999999757), 1);
+	failures += Check((uuid7_nanos(u) <= 999999999), 1);
+	failures += Check(u.segment, 0x0102);
+	failures += Check(u.rand, 0x04030201);
+
+	/* the decoded time packs back to the same 1/4096 ms */
+	uint8_t again[16];
+	struct timespec decoded = { (time_t)u.seconds, (long)uuid7_nanos(u) };
+	uuid7_pack_rfc9562(again, decoded, u.segment, u.rand);
+	failures += Check(memcmp(again, ubuf, 16), 0);
+
+	/* as from uuidv7() of PostgreSQL, the example of RFC 9562 */
+	const char *example = "017F22E2-79B0-7CC3-98C4-DC0C0C07398F";
+	rv = uuid7_from_string(ubuf, example, strlen(example));
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+	failures += Check((intptr_t)uuid7_parts(&u, ubuf), (intptr_t)&u);
+	failures += Check(u.seconds, 1645557742);
+	failures += Check(u.hiseq, 0x18);
+	failures += Check(u.loseq, 0xC4);
+	failures += Check(u.segment, 0xDC0C);
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 1645557742;
+	uuid7_test_bogus_clock_nsec = 1000;
+	uuid7_test_bogus_clock_rv = 0;
+
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+	uuid7_gen_layout(&gen, UUID7_LAYOUT_RFC9562);
+
+	/* the 14 bit counter gives 16384 in the same 1/4096 ms */
+	uint8_t prev[16];
+	size_t issued = 0;
+	for (size_t i = 0; i < 16384; ++i) {
+		if (!uuid7_gen_next(&gen, ubuf)
+		    || (i && memcmp(prev, ubuf, 16) >= 0)) {
+			break;
+		}
+		memcpy(prev, ubuf, 16);
+		++issued;
+	}
+	failures += Check(issued, 16384);
+	failures += Check(uuid7_test_counter(prev), 0x3FFF);
+	failures += Check(prev[7], 4);
+
+	/* unless the random bytes sort, borrowing moves to the next 1/4096 */
+	uuid7_gen_policy(&gen, UUID7_POLICY_BORROW);
+	for (size_t i = 0; i < 64 && prev[7] == 4; ++i) {
+		failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf),
+				  (intptr_t)ubuf);
+		failures += Check((memcmp(prev, ubuf, 16) < 0), 1);
+		memcpy(prev, ubuf, 16);
+	}
+	failures += Check(ubuf[7], 5);
+	failures += Check(uuid7_test_counter(ubuf), 0);
+	uuid7_gen_policy(&gen, UUID7_POLICY_FAIL);
+
+	/* the clock is now behind the last issued */
+	failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf), (intptr_t)NULL);
+
+	/* a batch carries in to the next 1/4096 ms */
+	static uint8_t uuid7s[20000][16];
+	uuid7_gen_layout(&gen, UUID7_LAYOUT_RFC9562);
+	rv = uuid7_gen_n(&gen, uuid7s[0], 20000);
+	failures += Check((intptr_t)rv, (intptr_t)uuid7s[0]);
+	for (size_t i = 1; i < 20000; ++i) {
+		int cmp = memcmp(uuid7s[i - 1], uuid7s[i], 16);
+		failures += Check((cmp < 0), 1);
+	}
+	failures += Check(uuid7s[19999][7], 5);
+	failures += Check(uuid7_test_counter(uuid7s[19999]), 20000 - 16384 - 1);
+
+	/* the last 1/4096 ms of a second carries in to the next second */
+	uuid7_test_bogus_clock_nsec = 999999999;
+	uuid7_gen_reset(&gen);
+	rv = uuid7_gen_n(&gen, uuid7s[0], 16385);
+	failures += Check((intptr_t)rv, (intptr_t)uuid7s[0]);
+	uuid7_parts(&u, uuid7s[16384]);
+	failures += Check(u.seconds, 1645557743);
+	failures += Check(uuid7_nanos(u), 0);
+	failures += Check((memcmp(uuid7s[16383], uuid7s[16384], 16) < 0), 1);
+
+	/* sorts with others' RFC 9562 UUIDs of the milliseconds around */
+	ts.tv_sec = 1645557742;
+	ts.tv_nsec = 0;
+	uuid7_gen_reset(&gen);
+	uuid7_test_bogus_clock_nsec = 1000000;
+	failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf), (intptr_t)ubuf);
+	uint8_t other[16];
+	uuid7_pack_rfc9562(other, ts, 0xFFFF, 0xFFFFFFFF);
+	other[8] |= 0x3F;
+	other[9] = 0xFF;
+	failures += Check((memcmp(other, ubuf, 16) < 0), 1);
+	ts.tv_nsec = 2000000;
+	uuid7_pack_rfc9562(other, ts, 0, 0);
+	failures += Check((memcmp(ubuf, other, 16) < 0), 1);
+
+	/* back to the python docs layout */
+	uuid7_gen_layout(&gen, UUID7_LAYOUT_SECONDS);
+	failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf), (intptr_t)ubuf);
+	uuid7_parts(&u, ubuf);
+	failures += Check(u.uuid_var, UUID7_VARIANT);
+	failures += Check(uuid7_nanos(u), 1000000);
+
+	uuid7_clock_gettime = orig_gettime;
+
+	return failures;
+}
+
+/* a clock which advances by step_ns every reads calls */
+uint64_t uuid7_test_step_clock_ns = 0;
+uint64_t uuid7_test_step_clock_step_ns = 0;
+unsigned uuid7_test_step_clock_reads = 1;
+unsigned uuid7_test_step_clock_calls = 0;
+unsigned uuid7_test_step_clock_fail_at = 0;
+int uuid7_test_step_clock_gettime(clockid_t clockid, struct timespec *tp)
+{
+	(void)clockid;
+
+	if (uuid7_test_step_clock_fail_at
+	    && (uuid7_test_step_clock_calls >= uuid7_test_step_clock_fail_at)) {
+		return -1;
+	}
+	tp->tv_sec = uuid7_test_step_clock_ns / 1000000000;
+	tp->tv_nsec = uuid7_test_step_clock_ns % 1000000000;
+	++uuid7_test_step_clock_calls;
+	if ((uuid7_test_step_clock_calls % uuid7_test_step_clock_reads) == 0) {
+		uuid7_test_step_clock_ns += uuid7_test_step_clock_step_ns;
+	}
+	return 0;
+}
+
+static void uuid7_test_step_clock(uint64_t step_ns, unsigned reads)
+{
+	uuid7_test_step_clock_ns = 102556800ULL * 1000000000;
+	uuid7_test_step_clock_step_ns = step_ns;
+	uuid7_test_step_clock_reads = reads;
+	uuid7_test_step_clock_calls = 0;
+}
+
+/* selects the clock, as if it ticks every step_ns, read reads per tick */
+static unsigned uuid7_test_set_clock(clockid_t clockid, uint64_t step_ns,
+				     unsigned reads)
+{
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	uuid7_clock_gettime = uuid7_test_step_clock_gettime;
+	uuid7_test_step_clock(step_ns, reads);
+
+	unsigned failures = Check(uuid7_set_clock(clockid), 0);
+
+	uuid7_clock_gettime = orig_gettime;
+	return failures;
+}
+
+static unsigned check_clock_probe_steps(uint64_t step_ns, unsigned reads,
+					unsigned expect_tick_bits,
+					unsigned expect_hiseq_bits)
+{
+	unsigned failures = 0;
+
+	uuid7_test_step_clock(step_ns, reads);
+
+	struct uuid7_clock_info info;
+	failures += Check(uuid7_clock_probe(CLOCK_REALTIME, &info), 0);
+	failures += Check(info.samples, UUID7_CLOCK_PROBE_SAMPLES);
+	failures += Check(info.tick_bits, expect_tick_bits);
+	failures += Check(info.hiseq_bits, expect_hiseq_bits);
+	if ((reads > 1) || !step_ns) {
+		failures += Check((info.duplicates > 0), 1);
+	} else {
+		failures += Check(info.duplicates, 0);
+	}
+	if (step_ns) {
+		failures += Check(info.step_ns, step_ns);
+	}
+
+	return failures;
+}
+
+unsigned check_clock(void)
+{
+	unsigned failures = 0;
+
+	struct uuid7_clock_info info;
+	memset(&info, 0xFF, sizeof(info));
+	failures += Check(uuid7_clock_probe(1234567, &info), -1);
+	failures += Check(info.samples, 0);
+	failures += Check(info.hiseq_bits, 0);
+
+	clockid_t orig_clockid = uuid7_get_clock(NULL);
+	failures += Check(uuid7_set_clock(1234567), -1);
+	failures += Check(uuid7_get_clock(NULL), orig_clockid);
+
+	failures += Check(uuid7_get_clock(&info), orig_clockid);
+	failures += Check(info.clockid, orig_clockid);
+	failures += Check(info.samples, UUID7_CLOCK_PROBE_SAMPLES);
+	failures += Check((info.hiseq_bits <= 6), 1);
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	uuid7_clock_gettime = uuid7_test_step_clock_gettime;
+
+	/* a 1 ns clock, read every ns, has all 6 bits */
+	failures += check_clock_probe_steps(1, 1, 0, 6);
+	/* read every 16 ns, the low 4 bits never change */
+	failures += check_clock_probe_steps(16, 1, 4, 2);
+	/* ticks of 1 us, read 4 times per tick */
+	failures += check_clock_probe_steps(1000, 4, 10, 0);
+	/* ticks of 8 ns, read 3 times per tick */
+	failures += check_clock_probe_steps(8, 3, 3, 3);
+	/* a clock which never moves */
+	failures += check_clock_probe_steps(0, 1, 30, 0);
+
+	/* a clock which fails part way through the probe */
+	uuid7_test_step_clock_calls = 0;
+	uuid7_test_step_clock_fail_at = 10;
+	failures += Check(uuid7_clock_probe(CLOCK_REALTIME, &info), -1);
+	failures += Check(info.samples, 0);
+	uuid7_test_step_clock_fail_at = 0;
+	uuid7_clock_gettime = orig_gettime;
+
+	/* the time since boot is far behind the time since the epoch */
+	failures += Check(uuid7_set_clock(CLOCK_MONOTONIC), 0);
+	failures += Check(uuid7_get_clock(&info), CLOCK_MONOTONIC);
+	failures += Check(info.clockid, CLOCK_MONOTONIC);
+	uuid7_reset();
+
+	uint8_t ubuf[16];
+	struct uuid7 u;
+	while (!uuid7(ubuf)) ;
+	uuid7_parts(&u, ubuf);
+	failures += Check(((uint64_t)u.seconds < 102556800), 1);
+
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+	failures += Check(uuid7_set_clock(CLOCK_REALTIME), 0);
+	uuid7_reset();
+
+	/* the generator keeps the clock of uuid7_gen_init */
+	while (!uuid7_gen_next(&gen, ubuf)) ;
+	uuid7_parts(&u, ubuf);
+	failures += Check(((uint64_t)u.seconds < 102556800), 1);
+
+	failures += Check(uuid7_gen_clock(&gen, 1234567), -1);
+	failures += Check(uuid7_gen_clock(&gen, CLOCK_REALTIME), 0);
+	uuid7_gen_reset(&gen);
+	uint8_t uuid7s[2][16];
+	while (!uuid7_gen_n(&gen, uuid7s[0], 2)) ;
+	uuid7_parts(&u, uuid7s[1]);
+	failures += Check(((uint64_t)u.seconds > 102556800), 1);
+
+	/* a generator may read a clock other than the one of uuid7 */
+	failures += Check(uuid7_gen_clock(&gen, CLOCK_MONOTONIC), 0);
+	uuid7_gen_reset(&gen);
+	while (!uuid7_gen_n(&gen, uuid7s[0], 2)) ;
+	uuid7_parts(&u, uuid7s[1]);
+	failures += Check(((uint64_t)u.seconds < 102556800), 1);
+	while (!uuid7(ubuf)) ;
+	uuid7_parts(&u, ubuf);
+	failures += Check(((uint64_t)u.seconds > 102556800), 1);
+
+	/* not as probed on this machine, so that later checks are the same */
+	failures += uuid7_test_set_clock(orig_clockid, 1, 1);
+
+	return failures;
+}
+
+#ifdef UUID7_ADAPTIVE_SEQ
+unsigned check_adaptive_seq(void)
+{
+	unsigned failures = 0;
+
+	/* a clock of 16 ns ticks leaves 4 bits for the sequence */
+	failures += uuid7_test_set_clock(CLOCK_REALTIME, 16, 4);
+	struct uuid7_clock_info info;
+	uuid7_get_clock(&info);
+	failures += Check(info.tick_bits, 4);
+	const size_t per_tick = 256 << 4;
+
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 102556800;
+	uuid7_test_bogus_clock_nsec = 1600;
+	uuid7_test_bogus_clock_rv = 0;
+	uuid7_reset();
+
+	/* while the clock stays within the tick, the sequence carries on */
+	uint8_t prev[16];
+	uint8_t ubuf[16];
+	struct uuid7 u;
+	size_t issued = 0;
+	for (size_t i = 0; i < per_tick; ++i) {
+		if (!uuid7(ubuf)) {
+			break;
+		}
+		if (i && memcmp(prev, ubuf, 16) >= 0) {
+			break;
+		}
+		memcpy(prev, ubuf, 16);
+		++issued;
+	}
+	failures += Check(issued, per_tick);
+	uuid7_parts(&u, prev);
+	failures += Check(uuid7_nanos(u), 1615);
+	failures += Check(u.loseq, 0xFF);
+
+	issued = 0;
+	for (size_t i = 0; i < per_tick; ++i) {
+		if (!uuid7_gen_next(&gen, ubuf)) {
+			break;
+		}
+		if (i && memcmp(prev, ubuf, 16) >= 0) {
+			break;
+		}
+		memcpy(prev, ubuf, 16);
+		++issued;
+	}
+	failures += Check(issued, per_tick);
+
+	/* the tick is used up */
+	failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf), (intptr_t)NULL);
+
+	static uint8_t uuid7s[256 << 4][16];
+	uuid7_gen_reset(&gen);
+	failures += Check((intptr_t)uuid7_gen_n(&gen, uuid7s[0], per_tick),
+			  (intptr_t)uuid7s[0]);
+	uuid7_parts(&u, uuid7s[per_tick - 1]);
+	failures += Check(uuid7_nanos(u), 1615);
+	failures += Check(u.loseq, 0xFF);
+	for (size_t i = 1; i < per_tick; ++i) {
+		int cmp = memcmp(uuid7s[i - 1], uuid7s[i], 16);
+		failures += Check((cmp < 0), 1);
+	}
+
+	/* the next tick */
+	uuid7_test_bogus_clock_nsec = 1616;
+	failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf), (intptr_t)ubuf);
+	uuid7_parts(&u, ubuf);
+	failures += Check(uuid7_nanos(u), 1616);
+	failures += Check(u.loseq, 0);
+
+	/* a generator with a clock of 1 ns ticks has only the 256 */
+	uuid7_clock_gettime = uuid7_test_step_clock_gettime;
+	uuid7_test_step_clock(1, 1);
+	failures += Check(uuid7_gen_clock(&gen, CLOCK_REALTIME), 0);
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_gen_reset(&gen);
+	issued = 0;
+	for (size_t i = 0; i < per_tick; ++i) {
+		if (uuid7_gen_next(&gen, ubuf)) {
+			uuid7_parts(&u, ubuf);
+			failures += Check(uuid7_nanos(u), 1616);
+			++issued;
+		}
+	}
+	/* after 256, only if the random bytes happen to sort */
+	failures += Check((issued >= 256 && issued < per_tick), 1);
+
+	uuid7_clock_gettime = orig_gettime;
+	failures += uuid7_test_set_clock(CLOCK_REALTIME, 1, 1);
+	uuid7_reset();
+
+	return failures;
+}
+#endif
+
+#ifndef UUID7_NO_THREADS
+/* the first UUID of the ring, yielding to the producer until it has one */
+static uint8_t *uuid7_test_take(struct uuid7_ring *ring, uint8_t *ubuf)
+{
+	for (size_t i = 0; i < 5000; ++i) {
+		if (uuid7_take(ring, ubuf)) {
+			return ubuf;
+		}
+		struct timespec ms = { 0, 1000000 };
+		thrd_sleep(&ms, NULL);
+	}
+	return NULL;
+}
+
+unsigned check_ring(void)
+{
+	unsigned failures = 0;
+
+	failures += Check((uuid7_ring_start(0, 0, 1000000) == NULL), 1);
+	failures += Check((uuid7_ring_start(100, 10, 1000000) == NULL), 1);
+	failures += Check((uuid7_ring_start(64, 64, 1000000) == NULL), 1);
+	failures += Check((uuid7_ring_start(64, 16, 0) == NULL), 1);
+	size_t huge = ((size_t)1) << (sizeof(size_t) * 8 - 2);
+	failures += Check((uuid7_ring_start(huge, 0, 1) == NULL), 1);
+	if (sizeof(size_t) > 4) {
+		/* too much to allocate */
+		huge = ((size_t)1) << (sizeof(size_t) * 8 - 8);
+		failures += Check((uuid7_ring_start(huge, 0, 1) == NULL), 1);
+	}
+	uuid7_thrd_create = uuid7_test_thrd_create_fail;
+	failures += Check((uuid7_ring_start(64, 16, 1000000) == NULL), 1);
+	uuid7_thrd_create = thrd_create;
+	uuid7_ring_stop(NULL);
+
+	/* any number are taken in order */
+	struct uuid7_ring *ring = uuid7_ring_start(256, 64, 1000000000);
+	failures += Check((ring != NULL), 1);
+	if (!ring) {
+		return failures;
+	}
+	uint8_t prev[16];
+	uint8_t ubuf[16];
+	failures += Check((uuid7_test_take(ring, prev) != NULL), 1);
+	for (size_t i = 0; i < 10000 && !failures; ++i) {
+		if (!uuid7_test_take(ring, ubuf)) {
+			Fail("uuid7_take %zu failed", i);
+		} else if (memcmp(prev, ubuf, 16) >= 0) {
+			char b1[80], b2[80];
+			Fail("%zu: %s >= %s", i,
+			     uuid7_to_string(b1, sizeof(b1), prev),
+			     uuid7_to_string(b2, sizeof(b2), ubuf));
+		}
+		memcpy(prev, ubuf, 16);
+	}
+	uuid7_ring_stop(ring);
+
+	/* a take down to the low-water mark wakes the producer */
+	ring = uuid7_ring_start(256, 64, 10000000000);
+	failures += Check((ring != NULL), 1);
+	if (!ring) {
+		return failures;
+	}
+	failures += Check((uuid7_test_take(ring, ubuf) != NULL), 1);
+	for (size_t i = 1; i < 200; ++i) {
+		failures += Check((uuid7_take(ring, ubuf) != NULL), 1);
+	}
+	struct timespec ms = { 0, 50000000 };
+	thrd_sleep(&ms, NULL);
+	size_t taken = 0;
+	for (size_t i = 0; i < 256; ++i) {
+		taken += uuid7_take(ring, ubuf) ? 1 : 0;
+	}
+	failures += Check(taken, 256);
+	uuid7_ring_stop(ring);
+
+	/* UUIDs older than max_age_ns are discarded */
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 102556800;
+	uuid7_test_bogus_clock_nsec = 0;
+	uuid7_test_bogus_clock_rv = 1;
+
+	/* while the clock fails, the ring stays empty */
+	ring = uuid7_ring_start(64, 16, 1000000);
+	failures += Check((ring != NULL), 1);
+	if (ring) {
+		thrd_sleep(&ms, NULL);
+		memset(ubuf, 0xFF, 16);
+		failures += Check((uuid7_take(ring, ubuf) == NULL), 1);
+		failures += Check((ubuf[0] | ubuf[6] | ubuf[15]), 0);
+		uuid7_ring_stop(ring);
+	}
+	uuid7_test_bogus_clock_rv = 0;
+
+	ring = uuid7_ring_start(64, 16, 1000000);
+	failures += Check((ring != NULL), 1);
+	if (!ring) {
+		uuid7_clock_gettime = orig_gettime;
+		return failures;
+	}
+	struct uuid7 u;
+	failures += Check((uuid7_test_take(ring, ubuf) != NULL), 1);
+	failures += Check(uuid7_parts(&u, ubuf)->seconds, 102556800);
+	uuid7_test_bogus_clock_sec = 102556810;
+	for (size_t i = 0; i < 5000 && u.seconds == 102556800; ++i) {
+		struct timespec ns = { 0, 1000000 };
+		thrd_sleep(&ns, NULL);
+		if (uuid7_test_take(ring, ubuf)) {
+			uuid7_parts(&u, ubuf);
+		}
+	}
+	failures += Check(u.seconds, 102556810);
+	uuid7_ring_stop(ring);
+
+	uuid7_clock_gettime = orig_gettime;
+	return failures;
+}
+#endif
+
+#if !defined(UUID7_NO_STATS) && !UUID7_NO_THREADS
+static int check_stats_thread_func(void *context)
+{
+	(void)context;
+	uint8_t ubuf[16];
+	return uuid7(ubuf) ? 0 : 1;
+}
+#endif
+
+unsigned check_stats(void)
+{
+	unsigned failures = 0;
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	ssize_t (*orig_getrandom)(void *buf, size_t buflen, unsigned int flags)
+	    = uuid7_getrandom;
+
+	uuid7_reset();
+	uuid7_stats_reset();
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 102556800;
+	uuid7_test_bogus_clock_nsec = 0;
+	uuid7_test_bogus_clock_rv = 0;
+
+	uint8_t ubuf[16];
+	for (size_t i = 0; i < 3; ++i) {
+		failures += Check((intptr_t)uuid7(ubuf), (intptr_t)ubuf);
+	}
+
+	uuid7_test_bogus_clock_rv = 1;
+	failures += Check((intptr_t)uuid7(ubuf), (intptr_t)NULL);
+	uuid7_test_bogus_clock_rv = 0;
+
+	uuid7_getrandom = uuid7_test_getrandom;
+	uuid7_test_getrandom_rv = -1;
+#ifdef UUID7_ENTROPY_POOL
+	uuid7_entropy_reset();
+#endif
+	failures += Check((intptr_t)uuid7(ubuf), (intptr_t)NULL);
+	uuid7_getrandom = orig_getrandom;
+
+	/* one second backwards */
+	uuid7_test_bogus_clock_sec -= 1;
+	uint8_t *rv = uuid7(ubuf);
+	uuid7_test_bogus_clock_sec += 1;
+#ifdef UUID7_NEVER_FAIL
+	size_t borrowed = 1;
+	failures += Check((intptr_t)rv, (intptr_t)ubuf);
+#else
+	size_t borrowed = 0;
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+#endif
+
+	/* more than 256 in the same nanosecond */
+	uint8_t batch[300 * 16];
+	failures += Check((intptr_t)uuid7_n(batch, 300), (intptr_t)batch);
+
+	/* the sequence used up, with random bytes which do not sort */
+	uint8_t zeros[4] = { 0, 0, 0, 0 };
+	uuid7_getrandom = uuid7_test_getrandom;
+	uuid7_test_getrandom_bytes = zeros;
+	uuid7_test_getrandom_bytes_size = sizeof(zeros);
+	uuid7_test_getrandom_rv = sizeof(zeros);
+	uuid7_test_bogus_clock_sec += 100;
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+	for (size_t i = 0; i < 256; ++i) {
+		failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf),
+				  (intptr_t)ubuf);
+	}
+	failures += Check((intptr_t)uuid7_gen_next(&gen, ubuf), (intptr_t)NULL);
+
+	uuid7_test_getrandom_bytes = NULL;
+	uuid7_test_getrandom_bytes_size = 0;
+	uuid7_test_getrandom_rv = 0;
+	uuid7_getrandom = orig_getrandom;
+	uuid7_clock_gettime = orig_gettime;
+
+	struct uuid7_stats stats;
+	memset(&stats, 0xFF, sizeof(stats));
+	failures += Check((intptr_t)uuid7_stats_get(&stats), (intptr_t)&stats);
+#ifdef UUID7_NO_STATS
+	struct uuid7_stats zeroed;
+	memset(&zeroed, 0x00, sizeof(zeroed));
+	failures += Check(memcmp(&stats, &zeroed, sizeof(stats)), 0);
+	(void)borrowed;
+#else
+	failures += Check(stats.calls, 3 + 1 + 1 + 1 + 1 + 257);
+	failures += Check(stats.successes, 3 + borrowed + 1 + 256);
+	failures += Check(stats.uuids, 3 + borrowed + 300 + 256);
+	failures += Check(stats.clock_failures, 1);
+	failures += Check(stats.random_failures, 1);
+	failures += Check(stats.backwards, 1);
+	failures += Check(stats.max_backwards_ns, 1000000000);
+	failures += Check(stats.borrowed, borrowed);
+	failures += Check(stats.seq_overflows, 2);
+	failures += Check(stats.seq_exhausted, 1);
+	failures += Check(stats.max_seq, 255);
+#endif
+
+	uuid7_stats_reset();
+	uuid7_stats_get(&stats);
+	failures += Check(stats.calls, 0);
+	failures += Check(stats.max_seq, 0);
+
+#if !defined(UUID7_NO_STATS) && !UUID7_NO_THREADS
+	/* the counts of a thread are added when it exits */
+	thrd_t thread;
+	thrd_create(&thread, check_stats_thread_func, NULL);
+	thrd_join(thread, NULL);
+	uuid7_stats_get(&stats);
+	failures += Check(stats.calls, 1);
+#endif
+
+	uuid7_reset();
+
+	return failures;
+}
+
+/* calls to getrandom for two refills of an entropy buffer */
+#ifdef UUID7_CHACHA20
+#define UUID7_TEST_REFILL_CALLS 1
+#else
+#define UUID7_TEST_REFILL_CALLS 2
+#endif
+
+unsigned check_gen_entropy(void)
+{
+	unsigned failures = 0;
+
+	uuid7_test_getrandom_orig = uuid7_getrandom;
+	uuid7_getrandom = uuid7_test_getrandom_counting;
+	uuid7_test_getrandom_calls = 0;
+
+	uint8_t entropy[64];
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, entropy, sizeof(entropy));
+
+	uint8_t ubuf[16];
+	size_t per_buffer = sizeof(entropy) / sizeof(uint32_t);
+	for (size_t i = 0; i < ((2 * per_buffer) - 1); ++i) {
+		while (!uuid7_gen_next(&gen, ubuf)) ;
+	}
+	failures += Check(uuid7_test_getrandom_calls, UUID7_TEST_REFILL_CALLS);
+
+	/* the child must not re-use what is buffered in the parent */
+	pid_t pid = fork();
+	if (pid == 0) {
+		uuid7_test_getrandom_calls = 0;
+		while (!uuid7_gen_next(&gen, ubuf)) ;
+		exit(uuid7_test_getrandom_calls == 1 ? 0 : 1);
+	}
+	int status = -1;
+	waitpid(pid, &status, 0);
+	failures += Check(WIFEXITED(status), 1);
+	failures += Check(WEXITSTATUS(status), 0);
+
+	/* while the parent continues with the buffered bytes */
+	while (!uuid7_gen_next(&gen, ubuf)) ;
+	failures += Check(uuid7_test_getrandom_calls, UUID7_TEST_REFILL_CALLS);
+
+	/* a child not created by fork(3) says so directly */
+	uuid7_forked();
+	while (!uuid7_gen_next(&gen, ubuf)) ;
+	failures += Check(uuid7_test_getrandom_calls,
+			  UUID7_TEST_REFILL_CALLS + 1);
+
+	uuid7_getrandom = uuid7_test_getrandom_orig;
+
+	return failures;
+}
+
+#ifdef UUID7_ENTROPY_POOL
+
+unsigned check_entropy_pool(void)
+{
+	unsigned failures = 0;
+
+	uuid7_test_getrandom_orig = uuid7_getrandom;
+	uuid7_getrandom = uuid7_test_getrandom_counting;
+	uuid7_test_getrandom_calls = 0;
+	uuid7_entropy_reset();
+
+	uint8_t ubuf[16];
+	size_t per_pool = UUID7_ENTROPY_POOL_SIZE / 8;
+	for (size_t i = 0; i < ((2 * per_pool) - 1); ++i) {
+		while (!uuid7(ubuf)) ;
+	}
+	failures += Check(uuid7_test_getrandom_calls, UUID7_TEST_REFILL_CALLS);
+
+	/* the child must not re-use what is buffered in the parent */
+	pid_t pid = fork();
+	if (pid == 0) {
+		uuid7_test_getrandom_calls = 0;
+		while (!uuid7(ubuf)) ;
+		exit(uuid7_test_getrandom_calls == 1 ? 0 : 1);
+	}
+	int status = -1;
+	waitpid(pid, &status, 0);
+	failures += Check(WIFEXITED(status), 1);
+	failures += Check(WEXITSTATUS(status), 0);
+
+	/* while the parent continues with the buffered bytes */
+	while (!uuid7(ubuf)) ;
+	failures += Check(uuid7_test_getrandom_calls, UUID7_TEST_REFILL_CALLS);
+
+	uuid7_getrandom = uuid7_test_getrandom_orig;
+
+	return failures;
+}
+#endif
+
+#ifdef UUID7_CHACHA20
+/* friend functions and flags defined in uuid7.c, but not in uuid7.h */
+extern void uuid7_chacha20(uint8_t *out, size_t len, const uint8_t *key);
+extern int uuid7_chacha20_simd;
+
+static char *check_chacha20_hex(char *buf, const uint8_t *bytes, size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		sprintf(buf + (2 * i), "%02x", bytes[i]);
+	}
+	return buf;
+}
+
+/* RFC 8439, A.1, test vectors #1 and #2, then a 5th block of key 0-31 */
+static unsigned check_chacha20_stream(void)
+{
+	unsigned failures = 0;
+
+	uint8_t key[32];
+	memset(key, 0x00, sizeof(key));
+	uint8_t stream[5 * 64];
+	uuid7_chacha20(stream, sizeof(stream), key);
+
+	char hex[(2 * 64) + 1];
+	failures += Check_s(check_chacha20_hex(hex, stream, 64),
+			    "76b8e0ada0f13d90405d6ae55386bd28"
+			    "bdd219b8a08ded1aa836efcc8b770dc7"
+			    "da41597c5157488d7724e03fb8d84a37"
+			    "6a43b8f41518a11cc387b669b2ee6586");
+	failures += Check_s(check_chacha20_hex(hex, stream + 64, 64),
+			    "9f07e7be5551387a98ba977c732d080d"
+			    "cb0f29a048e3656912c6533e32ee7aed"
+			    "29b721769ce64e43d57133b074d839d5"
+			    "31ed1f28510afb45ace10a1f4b794d6f");
+
+	/* the key may be the start of the output */
+	for (size_t i = 0; i < sizeof(key); ++i) {
+		stream[i] = (uint8_t)i;
+	}
+	uuid7_chacha20(stream, sizeof(stream), stream);
+	failures += Check_s(check_chacha20_hex(hex, stream + (4 * 64), 64),
+			    "ffdba11827588c438f5434eac956be8f"
+			    "95a043ad04cdfd0a97d7fa49d40d099e"
+			    "e22d532ead770040fae354565b4a03f2"
+			    "1dfa941a3d4f76f4f99e2091e5a05565");
+
+	/* a partial block is the start of the block */
+	uint8_t partial[7];
+	memset(key, 0x00, sizeof(key));
+	uuid7_chacha20(partial, sizeof(partial), key);
+	failures += Check_s(check_chacha20_hex(hex, partial, sizeof(partial)),
+			    "76b8e0ada0f13d");
+
+	return failures;
+}
+
+unsigned check_chacha20(void)
+{
+	unsigned failures = 0;
+
+	for (int simd = 1; simd >= 0; --simd) {
+		uuid7_chacha20_simd = simd;
+		failures += check_chacha20_stream();
+	}
+	uuid7_chacha20_simd = 1;
+
+	uuid7_test_getrandom_orig = uuid7_getrandom;
+	uuid7_getrandom = uuid7_test_getrandom_counting;
+	uuid7_test_getrandom_calls = 0;
+
+	/* each refill hands out all but the 32 bytes of the next key */
+	uint8_t entropy[64];
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, entropy, sizeof(entropy));
+	uint8_t ubuf[16];
+	size_t per_refill = (sizeof(entropy) - 32) / sizeof(uint32_t);
+	for (size_t i = 0; i < (per_refill * UUID7_CHACHA20_RESEED); ++i) {
+		while (!uuid7_gen_next(&gen, ubuf)) ;
+	}
+	failures += Check(uuid7_test_getrandom_calls, 1);
+
+	/* the key was replaced, and the handed out bytes cleared */
+	uint8_t key[32];
+	memcpy(key, entropy, sizeof(key));
+	failures += Check((memcmp(entropy + 32, entropy + 48, 16) == 0), 1);
+	while (!uuid7_gen_next(&gen, ubuf)) ;
+	failures += Check((memcmp(key, entropy, sizeof(key)) != 0), 1);
+
+	/* and periodically, the keystream is reseeded from getrandom */
+	failures += Check(uuid7_test_getrandom_calls, 2);
+
+	/* a buffer smaller than a block is refilled from getrandom */
+	uuid7_gen_init(&gen, entropy, 32);
+	for (size_t i = 0; i < ((32 / sizeof(uint32_t)) + 1); ++i) {
+		while (!uuid7_gen_next(&gen, ubuf)) ;
+	}
+	failures += Check(uuid7_test_getrandom_calls, 4);
+
+	uuid7_getrandom = uuid7_test_getrandom_orig;
+
+	return failures;
+}
+#endif
+
+#ifdef UUID7_FAST_RANDOM
+unsigned check_fast_random(void)
+{
+	unsigned failures = 0;
+
+	/* the hook is the generator, seeded on first use */
+	uuid7_entropy_reset();
+	uint8_t bytes[2][13];
+	memset(bytes, 0x00, sizeof(bytes));
+	ssize_t got = uuid7_getrandom(bytes[0], sizeof(bytes[0]), 0);
+	failures += Check(got, sizeof(bytes[0]));
+	got = uuid7_getrandom(bytes[1], sizeof(bytes[1]), 0);
+	failures += Check(got, sizeof(bytes[1]));
+	failures += Check((memcmp(bytes[0], bytes[1], sizeof(bytes[0])) != 0),
+			  1);
+
+	/* a child is reseeded, rather than repeat the parent's bytes */
+	int fds[2];
+	failures += Check(pipe(fds), 0);
+	pid_t pid = fork();
+	if (pid == 0) {
+		uint8_t child[8];
+		uuid7_getrandom(child, sizeof(child), 0);
+		ssize_t written = write(fds[1], child, sizeof(child));
+		exit(written == (ssize_t)sizeof(child) ? 0 : 1);
+	}
+	uint8_t parent[8];
+	uint8_t child[8];
+	uuid7_getrandom(parent, sizeof(parent), 0);
+	failures += Check(read(fds[0], child, sizeof(child)), sizeof(child));
+	int status = -1;
+	waitpid(pid, &status, 0);
+	failures += Check(WIFEXITED(status), 1);
+	failures += Check(WEXITSTATUS(status), 0);
+	failures += Check((memcmp(parent, child, sizeof(child)) != 0), 1);
+	close(fds[0]);
+	close(fds[1]);
+
+	return failures;
+}
+#endif
+
+#ifdef UUID7_TSC
+/* friend functions and hooks defined in uuid7.c, but not in uuid7.h */
+extern uint64_t (*uuid7_tsc_read)(void);
+extern int (*uuid7_tsc_check)(void);
+extern void uuid7_tsc_reset(void);
+
+static int uuid7_test_tsc_never(void)
+{
+	return 0;
+}
+
+/* as set before main replaced it with uuid7_test_tsc_never */
+int (*uuid7_test_tsc_check_orig)(void) = NULL;
+
+static int uuid7_test_tsc_always(void)
+{
+	return 1;
+}
+
+uint64_t uuid7_test_tsc = 0;
+static uint64_t uuid7_test_tsc_read(void)
+{
+	return uuid7_test_tsc;
+}
+
+static void uuid7_test_clock_set_ns(uint64_t ns)
+{
+	uuid7_test_bogus_clock_sec = ns / 1000000000;
+	uuid7_test_bogus_clock_nsec = ns % 1000000000;
+}
+
+/* the nanoseconds since the epoch of the next UUID of gen, or 0 */
+static uint64_t uuid7_test_tsc_stamp(struct uuid7_gen *gen)
+{
+	uint8_t ubuf[16];
+	struct uuid7 u;
+	if (!uuid7_gen_next(gen, ubuf)) {
+		return 0;
+	}
+	uuid7_parts(&u, ubuf);
+	return (((uint64_t)u.seconds) * 1000000000) + uuid7_nanos(u);
+}
+
+unsigned check_tsc(void)
+{
+	unsigned failures = 0;
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+	uint64_t (*orig_tsc_read)(void) = uuid7_tsc_read;
+
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_rv = 0;
+	uuid7_tsc_read = uuid7_test_tsc_read;
+	uuid7_tsc_check = uuid7_test_tsc_always;
+	uuid7_tsc_reset();
+	uuid7_stats_reset();
+
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+
+	/* a 4 GHz counter, calibrated over the first millisecond */
+	const uint64_t per_ns = 4;
+	uint64_t clock_ns = 102556800ULL * 1000000000;
+	uuid7_test_clock_set_ns(clock_ns);
+	uuid7_test_tsc = 1000;
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns);
+
+	clock_ns += UUID7_TSC_CALIBRATE_NS / 2;
+	uuid7_test_clock_set_ns(clock_ns);
+	uuid7_test_tsc += per_ns * (UUID7_TSC_CALIBRATE_NS / 2);
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns);
+
+	clock_ns += UUID7_TSC_CALIBRATE_NS / 2;
+	uuid7_test_clock_set_ns(clock_ns);
+	uuid7_test_tsc += per_ns * (UUID7_TSC_CALIBRATE_NS / 2);
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns);
+
+	/* while the clock stands still, the counter moves on */
+	uuid7_test_tsc += per_ns * 1000;
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns + 1000);
+
+	/* at the end of the period, the clock is 500ns ahead */
+	uint64_t stamped = clock_ns + 1000 + UUID7_TSC_PERIOD_NS;
+	uuid7_test_tsc += per_ns * UUID7_TSC_PERIOD_NS;
+	clock_ns = stamped + 500;
+	uuid7_test_clock_set_ns(clock_ns);
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns);
+
+	struct uuid7_stats stats;
+	uuid7_stats_get(&stats);
+#ifndef UUID7_NO_STATS
+	failures += Check(stats.tsc_anchors, 1);
+	failures += Check(stats.max_tsc_drift_ns, 500);
+#endif
+	failures += Check(stats.tsc_drift_ns, 500);
+
+	/* the next period the clock is behind, the stamps do not go back */
+	uuid7_test_tsc += per_ns * UUID7_TSC_PERIOD_NS;
+	clock_ns += UUID7_TSC_PERIOD_NS - 2000;
+	uuid7_test_clock_set_ns(clock_ns);
+	uint64_t ns = uuid7_test_tsc_stamp(&gen);
+	failures += Check((ns > clock_ns), 1);
+	uuid7_stats_get(&stats);
+	failures += Check((stats.tsc_drift_ns <= -2000), 1);
+	failures += Check((stats.tsc_drift_ns > -3000), 1);
+
+	/* while running slower, until the clock catches up */
+	uuid7_test_tsc += per_ns;
+	uint64_t next = uuid7_test_tsc_stamp(&gen);
+	failures += Check((next >= ns), 1);
+	uuid7_test_tsc += 2 * per_ns * UUID7_TSC_PERIOD_NS;
+	clock_ns += 2 * UUID7_TSC_PERIOD_NS;
+	uuid7_test_clock_set_ns(clock_ns);
+	ns = uuid7_test_tsc_stamp(&gen);
+	failures += Check((ns >= next), 1);
+	failures += Check(ns, clock_ns);
+
+	/* after a long idle, the stamp is from the clock */
+	uuid7_test_tsc += 10 * per_ns * UUID7_TSC_PERIOD_NS;
+	clock_ns += 10 * UUID7_TSC_PERIOD_NS;
+	uuid7_test_clock_set_ns(clock_ns);
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns);
+
+	/* if the clock can not be read, there is no UUID */
+	uuid7_test_tsc += 2 * per_ns * UUID7_TSC_PERIOD_NS;
+	uuid7_test_bogus_clock_rv = 1;
+	failures += Check(uuid7_test_tsc_stamp(&gen), 0);
+	uuid7_test_bogus_clock_rv = 0;
+
+	/* a clock set back starts a new calibration */
+	clock_ns -= 1000000000;
+	uuid7_test_clock_set_ns(clock_ns);
+	uuid7_gen_reset(&gen);
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns);
+	uuid7_test_tsc += per_ns * 1000;
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns);
+
+	/* without an invariant counter, each stamp is from the clock */
+	uuid7_tsc_check = uuid7_test_tsc_never;
+	uuid7_tsc_reset();
+	uuid7_test_tsc += per_ns * 1000;
+	clock_ns += 1000;
+	uuid7_test_clock_set_ns(clock_ns);
+	failures += Check(uuid7_test_tsc_stamp(&gen), clock_ns);
+
+	/* and with the real counter, if any, stamps are in order */
+	uuid7_clock_gettime = orig_gettime;
+	uuid7_tsc_read = orig_tsc_read;
+	uuid7_tsc_check = uuid7_test_tsc_check_orig;
+	uuid7_tsc_reset();
+	uuid7_gen_reset(&gen);
+	ns = 0;
+	struct timespec begin;
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &begin);
+	do {
+		next = uuid7_test_tsc_stamp(&gen);
+		failures += Check((next > ns), 1);
+		ns = next;
+		clock_gettime(CLOCK_REALTIME, &now);
+	} while (elapsed_timespec(begin, now) < 0.003 && !failures);
+	uint64_t now_ns = (now.tv_sec * 1000000000ULL) + now.tv_nsec;
+	failures += Check((ns <= now_ns + 1000000), 1);
+	failures += Check((ns + 1000000 >= now_ns), 1);
+
+	/* the other checks expect the clock to be read for each UUID */
+	uuid7_tsc_check = uuid7_test_tsc_never;
+	uuid7_tsc_reset();
+
+	return failures;
+}
+#endif
+
+unsigned check_batch(void)
+{
+	unsigned failures = 0;
+
+	size_t uuids_len = 1000;
+	uint8_t uuid7s[1000][16];
+	memset(uuid7s, '?', sizeof(uuid7s));
+
+	uint8_t *rv = uuid7_n(uuid7s[0], uuids_len);
+	failures += Check((intptr_t)rv, (intptr_t)uuid7s[0]);
+
+	struct uuid7 u;
+	for (size_t i = 0; i < uuids_len; ++i) {
+		rv = (uint8_t *)uuid7_parts(&u, uuid7s[i]);
+		failures += Check((rv != NULL), 1);
+		if (i > 0) {
+			int cmp = memcmp(uuid7s[i - 1], uuid7s[i], 16);
+			failures += Check((cmp < 0), 1);
+		}
+	}
+
+	/* a single uuid7 after the batch sorts after the batch */
+	uint8_t after[16];
+	do {
+		rv = uuid7(after);
+	} while (!rv);
+	failures += Check((memcmp(uuid7s[uuids_len - 1], after, 16) < 0), 1);
+
+	rv = uuid7_n(NULL, 0);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	rv = uuid7_n(uuid7s[0], SIZE_MAX);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	return failures;
+}
+
+unsigned check_batch_sequence_rollover(void)
+{
+	unsigned failures = 0;
+
+	int (*orig_gettime)(clockid_t clockid, struct timespec *tp) =
+	    uuid7_clock_gettime;
+
+	uuid7_clock_gettime = uuid7_test_bogus_clock_gettime;
+	uuid7_test_bogus_clock_sec = 1711030306;
+	uuid7_test_bogus_clock_nsec = 999999999;
+	uuid7_test_bogus_clock_rv = 0;
+
+	uuid7_reset();
+
+	size_t uuids_len = 600;
+	uint8_t uuid7s[600][16];
+	memset(uuid7s, '?', sizeof(uuid7s));
+
+	uint8_t *rv = uuid7_n(uuid7s[0], uuids_len);
+	failures += Check((intptr_t)rv, (intptr_t)uuid7s[0]);
+
+	struct uuid7 u;
+	for (size_t i = 0; i < uuids_len; ++i) {
+		uuid7_parts(&u, uuid7s[i]);
+		failures += Check(u.loseq, (i % 256));
+		if (i < 256) {
+			failures += Check(u.seconds, 1711030306);
+			failures += Check(uuid7_nanos(u), 999999999);
+		} else {
+			failures += Check(u.seconds, 1711030307);
+			failures += Check(uuid7_nanos(u), ((i / 256) - 1));
+		}
+		if (i > 0) {
+			int cmp = memcmp(uuid7s[i - 1], uuid7s[i], 16);
+			failures += Check((cmp < 0), 1);
+		}
+	}
+
+	/* the clock has not caught up with the end of the batch */
+	rv = uuid7_n(uuid7s[0], 1);
+#ifdef UUID7_NEVER_FAIL
+	failures += Check((intptr_t)rv, (intptr_t)uuid7s[0]);
+	int cmp = memcmp(uuid7s[uuids_len - 1], uuid7s[0], 10);
+	failures += Check((cmp < 0), 1);
+#else
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check_s((const char *)uuid7s[0], "");
+#endif
+
+	uuid7_test_bogus_clock_rv = 1;
+	rv = uuid7_n(uuid7s[0], 2);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_clock_gettime = orig_gettime;
+
+	uuid7_reset();
+
+	return failures;
+}
+
+unsigned check_batch_getrandom(void)
+{
+	unsigned failures = 0;
+
+	ssize_t (*orig_getrandom)(void *buf, size_t buflen, unsigned int flags)
+	    = uuid7_getrandom;
+
+	uint8_t random_bytes[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	uuid7_getrandom = uuid7_test_getrandom;
+	uuid7_test_getrandom_bytes = random_bytes;
+	uuid7_test_getrandom_bytes_size = sizeof(random_bytes);
+
+	/* short reads are continued until the buffer is full */
+	uuid7_test_getrandom_rv = 8;
+
+	uint8_t uuid7s[4][16];
+	memset(uuid7s, '?', sizeof(uuid7s));
+
+	uint8_t *rv = uuid7_n(uuid7s[0], 4);
+	failures += Check((intptr_t)rv, (intptr_t)uuid7s[0]);
+	for (size_t i = 0; i < 4; ++i) {
+		struct uuid7 u;
+		uuid7_parts(&u, uuid7s[i]);
+		failures += Check(u.rand, 0x08070605);
+	}
+
+	/* a read larger than requested is an error */
+	uuid7_test_getrandom_rv = 100;
+	rv = uuid7_n(uuid7s[0], 4);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+
+	uuid7_test_getrandom_rv = -1;
+	rv = uuid7_n(uuid7s[0], 4);
+	failures += Check((intptr_t)rv, (intptr_t)NULL);
+	failures += Check_s((const char *)uuid7s[3], "");
+
+	uuid7_test_getrandom_bytes = NULL;
+	uuid7_test_getrandom_bytes_size = 0;
+	uuid7_test_getrandom_rv = 0;
+	uuid7_getrandom = orig_getrandom;
+
+	return failures;
+}
+
+#if defined(UUID7_WITH_ATOMIC) || defined(UUID7_PER_CPU)
+#include <threads.h>
+
+#ifdef UUID7_PER_CPU
+#include <sched.h>
+/* only while on the same CPU is a thread guaranteed to be in order */
+void uuid7_test_pin_to_cpu(size_t i)
+{
+	cpu_set_t allowed;
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	size_t cpus = CPU_COUNT(&allowed);
+	for (size_t cpu = 0, n = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (CPU_ISSET(cpu, &allowed) && ((n++) == (i % cpus))) {
+			cpu_set_t pinned;
+			CPU_ZERO(&pinned);
+			CPU_SET(cpu, &pinned);
+			sched_setaffinity(0, sizeof(pinned), &pinned);
+			return;
+		}
+	}
+}
+#endif
+
+#define Uuid7_test_threads 4
+#define Uuid7_test_per_thread 10000
+uint8_t uuid7_test_ids[Uuid7_test_threads * Uuid7_test_per_thread][16];
+
+int uuid7_test_thread_func(void *context)
+{
+	uint8_t(*ids)[16] = (uint8_t(*)[16])context;
+#ifdef UUID7_PER_CPU
+	size_t thread_num = (ids - uuid7_test_ids) / Uuid7_test_per_thread;
+	uuid7_test_pin_to_cpu(thread_num);
+#endif
+	size_t batch = 50;
+	for (size_t i = 0; i < Uuid7_test_per_thread; i += batch) {
+		/* alternate between single UUIDs and batches */
+		if ((i / batch) % 2) {
+			while (!uuid7_n(ids[i], batch)) ;
+		} else {
+			for (size_t j = i; j < (i + batch); ++j) {
+				while (!uuid7(ids[j])) ;
+			}
+		}
+	}
+	return 0;
+}
+
+int uuid7_test_memcmp16(const void *a, const void *b)
+{
+	return memcmp(a, b, 16);
+}
+
+unsigned check_threads(void)
+{
+	unsigned failures = 0;
+
+	thrd_t threads[Uuid7_test_threads];
+	for (size_t i = 0; i < Uuid7_test_threads; ++i) {
+		void *ids = uuid7_test_ids[i * Uuid7_test_per_thread];
+		thrd_create(&threads[i], uuid7_test_thread_func, ids);
+	}
+	for (size_t i = 0; i < Uuid7_test_threads; ++i) {
+		thrd_join(threads[i], NULL);
+	}
+
+	size_t len = Uuid7_test_threads * Uuid7_test_per_thread;
+	for (size_t i = 1; i < len; ++i) {
+		if (i % Uuid7_test_per_thread) {
+			int cmp = memcmp(uuid7_test_ids[i - 1],
+					 uuid7_test_ids[i], 16);
+			failures += Check((cmp < 0), 1);
+		}
+	}
+
+#ifdef UUID7_WITH_ATOMIC
+	/* one global stream: no two share a timestamp and sequence */
+	size_t unique_bytes = 10;
+#else
+	/* one stream per CPU: the segment tells the streams apart */
+	size_t unique_bytes = 12;
+#endif
+	qsort(uuid7_test_ids, len, 16, uuid7_test_memcmp16);
+	for (size_t i = 1; i < len; ++i) {
+		int cmp = memcmp(uuid7_test_ids[i - 1], uuid7_test_ids[i],
+				 unique_bytes);
+		failures += Check((cmp < 0), 1);
+	}
+
+	return failures;
+}
+#endif
+
+int main(void)
+{
+	unsigned failures = 0;
+
+#ifdef UUID7_WITH_MUTEX
+	uuid7_mutex_init();
+#endif
+#ifdef UUID7_TSC
+	/* until check_tsc, expect the clock to be read for each UUID */
+	uuid7_test_tsc_check_orig = uuid7_tsc_check;
+	uuid7_tsc_check = uuid7_test_tsc_never;
+#endif
+#ifdef UUID7_ADAPTIVE_SEQ
+	/* until check_adaptive_seq, only the 8 bits of the sequence */
+	failures += uuid7_test_set_clock(CLOCK_REALTIME, 1, 1);
+#endif
+
+	failures += check_sortable();
+	failures += check_parts();
+	failures += check_to_string();
+	failures += check_pack();
+	failures += check_compare();
+	failures += check_sort();
+	failures += check_parts_n();
+	failures += check_hash64();
+	failures += check_time_range();
+	failures += check_to_string_n();
+	failures += check_from_string();
+	failures += check_base32();
+	failures += check_base64url();
+	failures += check_validate();
+	failures += check_bad_clock_id();
+	failures += check_bad_gettime();
+	failures += check_bad_getrandom();
+	failures += check_backwards_in_time();
+	failures += check_reset_all();
+	failures += check_batch();
+	failures += check_batch_sequence_rollover();
+	failures += check_batch_getrandom();
+	failures += check_gen();
+	failures += check_segment();
+	failures += check_gen_failures();
+	failures += check_gen_borrow();
+	failures += check_rfc9562();
+	failures += check_clock();
+	failures += check_stats();
+	failures += check_gen_entropy();
+#ifndef UUID7_NO_THREADS
+	failures += check_ring();
+#endif
+#ifdef UUID7_ENTROPY_POOL
+	failures += check_entropy_pool();
+#endif
+#ifdef UUID7_CHACHA20
+	failures += check_chacha20();
+#endif
+#ifdef UUID7_FAST_RANDOM
+	failures += check_fast_random();
+#endif
+#ifdef UUID7_TSC
+	failures += check_tsc();
+#endif
+#ifdef UUID7_ADAPTIVE_SEQ
+	failures += check_adaptive_seq();
+#endif
+#if defined(UUID7_WITH_ATOMIC) || defined(UUID7_PER_CPU)
+	failures += check_threads();
+#endif
 
 #ifdef UUID7_WITH_MUTEX
 	uuid7_mutex_destroy();
@@ -0,0 +1,159 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/* Copyright (C) 2024 Eric Herman <eric@freesa.org> */
+
+#include "uuid7.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+using namespace libuuid7::literals;
+
+static unsigned check_u64(const char *file, long line, const char *func,
+			  const char *name, uint64_t val, uint64_t expect)
+{
+	if (val == expect) {
+		return 0;
+	}
+	std::fprintf(stderr, "%s:%ld %s(): FAIL: %s\n"
+		     "\texpected %llu\n\t but was %llu\n", file, line, func,
+		     name, (unsigned long long)expect,
+		     (unsigned long long)val);
+	return 1;
+}
+
+#define Check(actual, expected) \
+	check_u64(__FILE__, __LINE__, __func__, \
+		  #actual, ((uint64_t)(actual)), ((uint64_t)(expected)))
+
+static unsigned check_s(const char *file, long line, const char *func,
+			const char *name, const std::string &val,
+			const std::string &expect)
+{
+	if (val == expect) {
+		return 0;
+	}
+	std::fprintf(stderr, "%s:%ld %s(): FAIL: %s\n"
+		     "\texpected '%s'\n\t but was '%s'\n", file, line, func,
+		     name, expect.c_str(), val.c_str());
+	return 1;
+}
+
+#define Check_s(actual, expected) \
+	check_s(__FILE__, __LINE__, __func__, #actual, actual, expected)
+
+/* made at compile time */
+constexpr libuuid7::id literal = "01234567-89ab-7cde-9f01-23456789abcd"_uuid7;
+static_assert(literal.hi() == UINT64_C(0x0123456789ab7cde), "hi");
+static_assert(literal.lo() == UINT64_C(0x9f0123456789abcd), "lo");
+static_assert(libuuid7::id::parse("0123456789AB7CDE9F0123456789ABCD")
+	      == literal, "bare hex, upper case");
+static_assert(!libuuid7::id::parse("01234567-89ab-4cde-9f01-23456789abcd"),
+	      "not a version 7");
+static_assert(!libuuid7::id::parse("01234567-89ab-7cde-9f01-23456789abc"),
+	      "too short");
+
+static unsigned check_parse(void)
+{
+	unsigned failures = 0;
+
+	auto u = libuuid7::id::parse("01234567-89ab-7cde-9f01-23456789abcd");
+	failures += Check(u.has_value(), 1);
+	failures += Check(*u == literal, 1);
+
+	failures += Check(libuuid7::id::parse("01234567_89ab-7cde-9f01-"
+					   "23456789abcd").has_value(), 0);
+	failures += Check(libuuid7::id::parse("0123456789ab7cde9f01234"
+					   "56789abcg").has_value(), 0);
+	failures += Check(libuuid7::id::parse("").has_value(), 0);
+
+	return failures;
+}
+
+static unsigned check_format(void)
+{
+	unsigned failures = 0;
+
+	failures += Check_s(literal.to_string(),
+			    "01234567-89ab-7cde-9f01-23456789abcd");
+
+	char buf[40] = { 0 };
+	failures += Check(literal.to_chars(buf) - buf, 36);
+	failures += Check_s(std::string(buf),
+			    "01234567-89ab-7cde-9f01-23456789abcd");
+
+	std::ostringstream os;
+	os << literal;
+	failures += Check_s(os.str(), "01234567-89ab-7cde-9f01-23456789abcd");
+
+#if defined(__cpp_lib_format)
+	failures += Check_s(std::format("[{}]", literal),
+			    "[01234567-89ab-7cde-9f01-23456789abcd]");
+#endif
+	return failures;
+}
+
+static unsigned check_generate(void)
+{
+	unsigned failures = 0;
+
+	std::vector<libuuid7::id> ids;
+	for (size_t i = 0; i < 1000; ++i) {
+		auto u = libuuid7::id::generate();
+		failures += Check(u.has_value(), 1);
+		ids.push_back(*u);
+	}
+	for (size_t i = 1; i < ids.size(); ++i) {
+		failures += Check(ids[i - 1] < ids[i], 1);
+		failures += Check(ids[i - 1].compare(ids[i]), -1);
+		failures += Check(ids[i].compare(ids[i - 1]), 1);
+		failures += Check(ids[i] != ids[i - 1], 1);
+	}
+
+	/* round trips through the bytes and the string */
+	libuuid7::id copy = libuuid7::id::from_bytes(ids[7].data());
+	failures += Check(copy == ids[7], 1);
+	failures += Check(copy.compare(ids[7]), 0);
+	auto parsed = libuuid7::id::parse(ids[7].to_string());
+	failures += Check(parsed.has_value(), 1);
+	failures += Check(*parsed == ids[7], 1);
+	failures += Check(copy.timestamp_ns(),
+			  uuid7_timestamp_ns(ids[7].data()));
+
+	struct uuid7_gen gen;
+	uuid7_gen_init(&gen, NULL, 0);
+	auto first = libuuid7::id::generate(gen);
+	auto second = libuuid7::id::generate(gen);
+	failures += Check(first.has_value() && second.has_value(), 1);
+	failures += Check(*first < *second, 1);
+
+	/* as keys */
+	std::set<libuuid7::id> sorted(ids.rbegin(), ids.rend());
+	failures += Check(sorted.size(), ids.size());
+	failures += Check(*sorted.begin() == ids.front(), 1);
+	std::map<libuuid7::id, size_t> indexes;
+	indexes[ids[3]] = 3;
+	failures += Check(indexes.at(ids[3]), 3);
+	std::unordered_set<libuuid7::id> hashed(ids.begin(), ids.end());
+	failures += Check(hashed.size(), ids.size());
+	failures += Check(hashed.count(ids[42]), 1);
+	failures += Check(std::hash<libuuid7::id>()(copy),
+			  std::hash<libuuid7::id>()(ids[7]));
+
+	return failures;
+}
+
+int main(void)
+{
+	unsigned failures = 0;
+
+	failures += check_parse();
+	failures += check_format();
+	failures += check_generate();
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,19 +1,36 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 /* Copyright (C) 2024 Eric Herman <eric@freesa.org> */
 
+#ifdef UUID7_PER_CPU
+/* for sched_getcpu */
+#define _GNU_SOURCE
+#endif
+
+/* the library always has the out-of-line encode, format, and decode */
+#undef UUID7_HEADER_ONLY
+#define UUID7_IMPLEMENTATION 1
 #include "uuid7.h"
 
+#include <stdint.h>
 #include <string.h>
 #include <sys/types.h>
 
 #ifndef uuid7_getrandom
 #include <sys/random.h>
+#ifdef UUID7_FAST_RANDOM
+/* a fast, but not cryptographic, generator seeded from getrandom */
+static ssize_t uuid7_xoshiro_getrandom(void *buf, size_t buflen,
+				       unsigned int flags);
+#define UUID7_GETRANDOM uuid7_xoshiro_getrandom
+#else
+#define UUID7_GETRANDOM getrandom
+#endif
 // for UUID7_DEBUG, allow swapping the getrandom function at runtime
 #ifdef UUID7_DEBUG
 ssize_t (*uuid7_getrandom)(void *buf, size_t buflen, unsigned int flags)
-    = getrandom;
+    = UUID7_GETRANDOM;
 #else
-#define uuid7_getrandom getrandom
+#define uuid7_getrandom UUID7_GETRANDOM
 #endif
 #endif
 
@@ -32,10 +49,7 @@ int (*uuid7_clock_gettime)(clockid_t clockid, struct timespec *tp)
 #define UUID7_CLOCKID CLOCK_REALTIME
 #endif
 
-// for UUID7_DEBUG, allow changing the uuid7_clockid at runtime, otherwise const
-#ifndef UUID7_DEBUG
-const
-#endif
+/* changed with uuid7_set_clock, which first checks that it can be read */
 clockid_t uuid7_clockid = UUID7_CLOCKID;
 
 #ifndef UUID7_NO_THREADS
@@ -47,311 +61,3580 @@ clockid_t uuid7_clockid = UUID7_CLOCKID;
 #endif
 #endif
 
+#if !(UUID7_NO_THREADS)
+// for UUID7_DEBUG, allow a thread to fail to start
+#ifdef UUID7_DEBUG
+int (*uuid7_thrd_create)(thrd_t *thr, thrd_start_t func, void *arg)
+    = thrd_create;
+#else
+#define uuid7_thrd_create thrd_create
+#endif
+#endif
+
+#include <stdlib.h>
+// for UUID7_DEBUG, allow an allocation to fail
+#ifdef UUID7_DEBUG
+void *(*uuid7_malloc)(size_t size) = malloc;
+#else
+#define uuid7_malloc malloc
+#endif
+
 #if (UUID7_NO_THREADS)
 #ifdef UUID7_WITH_MUTEX
 #error UUID7_WITH_MUTEX does not make sense with UUID7_NO_THREADS
 #endif
+#ifdef UUID7_WITH_ATOMIC
+#error UUID7_WITH_ATOMIC does not make sense with UUID7_NO_THREADS
+#endif
+#ifdef UUID7_PER_CPU
+#error UUID7_PER_CPU does not make sense with UUID7_NO_THREADS
+#endif
+#endif
+
+#if (defined(UUID7_WITH_MUTEX) + defined(UUID7_WITH_ATOMIC) \
+	+ defined(UUID7_PER_CPU)) > 1
+#error UUID7_WITH_MUTEX, UUID7_WITH_ATOMIC, UUID7_PER_CPU are exclusive
+#endif
+
+#if defined(UUID7_FAST_RANDOM) && defined(UUID7_ENTROPY_POOL)
+#error UUID7_FAST_RANDOM does not make sense with UUID7_ENTROPY_POOL
+#endif
+
+/*
+   With UUID7_NEVER_FAIL, uuid7() and uuid7_n() do not fail when the clock
+   goes backwards or the sequence is used up, but borrow from the last
+   issued UUID, as with a generator set to UUID7_POLICY_BORROW
+*/
+#ifdef UUID7_NEVER_FAIL
+#define UUID7_BORROW 1
+#else
+#define UUID7_BORROW 0
+#endif
+
+/*
+   With UUID7_ADAPTIVE_SEQ, the lowest bits of the nanoseconds which are
+   below the tick of the clock are used to extend the 8 bit sequence.
+   The clock is probed upon first use, and again by uuid7_set_clock;
+   until then, uuid7_seq_bits_probed is -1.
+*/
+#ifdef UUID7_ADAPTIVE_SEQ
+#if (UUID7_NO_THREADS)
+static int uuid7_seq_bits_probed = -1;
+#else
+#include <stdatomic.h>
+static _Atomic int uuid7_seq_bits_probed = -1;
+#endif
 #endif
 
 #ifdef UUID7_WITH_MUTEX
 #include <stdbool.h>
-static bool uuid7_mutex_initd = false;
-static mtx_t uuid7_mutex;
+/*
+   The mutex and the uuid7_last which it guards are on a line of their
+   own, thus taking the lock brings in the last UUID, and no other global
+   is bounced between CPUs with them.
+*/
+static struct {
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) mtx_t mutex;
+	uint8_t last[16];
+	bool initd;
+} uuid7_locked;
 #endif
 
+#ifdef UUID7_WITH_ATOMIC
+/*
+   Rather than a mutex around a global uuid7_last, the last issued
+   timestamp and sequence are packed in to a single 64-bit key which
+   is updated with compare-and-swap:
+
+      26 bits: the low bits of the seconds
+      30 bits: the nanoseconds
+       8 bits: the sequence
+
+   A 64-bit compare-and-swap is lock-free on far more targets than a
+   128-bit one (no need for cmpxchg16b), and keys are compared using
+   serial number arithmetic, thus the seconds wrapping every ~2.1 years
+   is harmless, so long as the clock never jumps by more than a year.
+
+   A key of zero means that nothing has been issued yet.
+*/
+#include <stdatomic.h>
+static struct {
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) _Atomic uint64_t key;
+} uuid7_last_key;
+#define UUID7_KEY_SEQ_BITS 8
+#define UUID7_KEY_NSEC_BITS 30
+#define UUID7_KEY_SEC_SHIFT (UUID7_KEY_NSEC_BITS + UUID7_KEY_SEQ_BITS)
+#define UUID7_KEY_SEC_MASK ((((uint64_t)1) << (64 - UUID7_KEY_SEC_SHIFT)) - 1)
+#elif defined(UUID7_PER_CPU)
+/*
+   Rather than a global or thread_local uuid7_last, there is one slot
+   per CPU, as reported by sched_getcpu (which recent glibc answers from
+   the rseq area, without a syscall). Each slot is on its own cache line
+   and has a segment which stays the same for the life of the process.
+
+   The lock of a slot is only ever contended if a thread is preempted or
+   migrated between choosing the slot and releasing it. If there are more
+   than UUID7_MAX_CPUS, some CPUs will share a slot.
+*/
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#ifndef UUID7_MAX_CPUS
+#define UUID7_MAX_CPUS 256
+#endif
+struct uuid7_cpu_slot {
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) uint8_t last[16];
+	uint16_t segment;
+	bool initd;
+	atomic_bool busy;
+};
+static struct uuid7_cpu_slot uuid7_cpu_slots[UUID7_MAX_CPUS];
+#elif defined(UUID7_WITH_MUTEX)
+#define uuid7_last uuid7_locked.last
+#else
 static
-#ifndef UUID7_WITH_MUTEX
 #if (!UUID7_NO_THREADS)
  thread_local
 #endif
-#endif
 uint8_t uuid7_last[16] = {
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
+#endif
 
 /*
-   takes a uint64_t and returns uint16_t
-   return value is computed by breaking the 64-bit input
-   into four 16-bit blocks and XORing the blocks together.
+   uuid7_reset_all moves the epoch on; each thread_local uuid7_last and
+   each generator keeps the epoch of its last reset, and resets itself
+   when next used in a later epoch. The check is a relaxed load.
 */
-#define u16_from_u64_xor(in) \
-	((uint16_t)(	((in >> (16 * 3)) & 0xFFFF) \
-		^	((in >> (16 * 2)) & 0xFFFF) \
-		^	((in >> (16 * 1)) & 0xFFFF) \
-		^	((in >> (16 * 0)) & 0xFFFF) \
-	))
+#if (UUID7_NO_THREADS)
+static unsigned uuid7_epoch = 0;
+#else
+#include <stdatomic.h>
+static _Atomic unsigned uuid7_epoch = 0;
+#endif
 
-/*
-   If the clock has gone backwards in time by a large amount,
-   the system may not catch up in a reasonable time, and thus
-   it may be more desirable to generate UUIDs that would sort
-   prior to UUIDs already generated.
+static unsigned uuid7_epoch_now(void)
+{
+#if (UUID7_NO_THREADS)
+	return uuid7_epoch;
+#else
+	return atomic_load_explicit(&uuid7_epoch, memory_order_relaxed);
+#endif
+}
 
-   In that situation, uuid7_reset can be used.
+#if !defined(UUID7_WITH_MUTEX) && !defined(UUID7_WITH_ATOMIC) \
+	&& !defined(UUID7_PER_CPU) && !(UUID7_NO_THREADS)
+/* the other builds share one state, which uuid7_reset_all resets */
+#define UUID7_LAST_THREAD_LOCAL 1
+static thread_local unsigned uuid7_last_epoch = 0;
+#endif
 
-   However, if not UUID7_WITH_MUTEX and not UUID7_NO_THREADS,
-   then this will need to be called for each thread which has
-   already set the thread_local uuid7_last.
+/*
+   A forked child must never hand out random bytes buffered by the
+   parent, thus the child increments the generation, and any buffer
+   filled in an earlier generation is discarded.
 */
-void uuid7_reset(void)
-{
-#ifdef UUID7_WITH_MUTEX
-	if (uuid7_mutex_initd) {
-		mtx_lock(&uuid7_mutex);
-	}
+static unsigned uuid7_fork_generation = 0;
+#ifndef ARDUINO
+#include <pthread.h>
+static int uuid7_atfork_rv = -1;
+#if (!UUID7_NO_THREADS)
+static once_flag uuid7_atfork_once = ONCE_FLAG_INIT;
+#endif
 #endif
 
-	memset(uuid7_last, 0x00, 16);
+#ifdef UUID7_ENTROPY_POOL
+/*
+   Rather than a call to getrandom for every UUID, random bytes are
+   requested in chunks of UUID7_ENTROPY_POOL_SIZE and handed out a few
+   at a time. The pool is per-thread even with UUID7_WITH_MUTEX, as
+   only the uuid7_last needs to be shared.
+*/
+static
+#if (!UUID7_NO_THREADS)
+ thread_local
+#endif
+uint8_t uuid7_pool_bytes[UUID7_ENTROPY_POOL_SIZE];
 
-#ifdef UUID7_WITH_MUTEX
-	if (uuid7_mutex_initd) {
-		mtx_unlock(&uuid7_mutex);
-	}
+static
+#if (!UUID7_NO_THREADS)
+ thread_local
+#endif
+struct uuid7_entropy_buf uuid7_pool;
 #endif
-}
 
-#include <assert.h>
+#ifdef UUID7_FAST_RANDOM
 /*
-#ifndef static_assert
-#define static_assert _Static_assert
-#endif
+   For IDs which need to be unique, but not unpredictable, the random
+   bytes come from a per-thread xoshiro256** generator, seeded once from
+   getrandom, and again in a forked child.
 */
-static_assert(sizeof(struct uuid7) == 16);
-static_assert(sizeof(uuid7_last) == 16);
-
-const uint8_t uuid7_version = 7;
-const uint8_t uuid7_variant = 1;
+#include <stdbool.h>
+struct uuid7_xoshiro {
+	uint64_t s[4];
+	unsigned fork_generation;
+	bool seeded;
+};
 
-uint8_t *uuid7_next(uint8_t *ubuf, struct timespec ts, uint16_t segment,
-		    uint32_t random_bytes, uint8_t *last_issued)
-{
-	assert(ubuf);
-	assert(ts.tv_nsec >= 0 && ts.tv_nsec <= 999999999);
-	int success = 0;
+static
+#if (!UUID7_NO_THREADS)
+ thread_local
+#endif
+struct uuid7_xoshiro uuid7_xoshiro;
+#endif
 
-	/*
-	   With only 24 bits of the fraction second,
-	   wanted are the 24 most significant bits,
-	   which might not be zero.
-	   Valid values are 0 to 999999999 or:
-	   const uint32_t nine9s = 0x3B9AC9FF;
-	   Because the bits 31 and 30 are never set,
-	   only bits 0-29, the bits to extract are 6 through 29:
-	   0011 1011 1001 1010 1100 1001 1111 1111
-	   --++ ++++ ++++ ++++ ++++ ++++ ++-- ----
-	   3    F    F    F    F    F    C    0
-
-	   However, since modern clocks really are nanosecond time,
-	   we will put those last 6 bits from the time in to the 6
-	   high bits of the 14 bit sequence number, 255 values for
-	   sequences created in the same nanosecond.
-	 */
-
-	uint64_t seconds = (((uint64_t)ts.tv_sec) & 0x0000000FFFFFFFFF);
-	uint16_t hifrac =
-	    ((((uint32_t)ts.tv_nsec) & 0x3FFC0000) >> (2 + (4 * 4)));
-
-	uint16_t lofrac = ((((uint32_t)ts.tv_nsec) & 0x0003FFC0) >> (4 + 2));
-	uint8_t hiseq = (ts.tv_nsec & 0x3F);
-
-	ubuf[0] = (seconds & 0x0000000FF0000000) >> (7 * 4);
-	ubuf[1] = (seconds & 0x000000000FF00000) >> (5 * 4);
-	ubuf[2] = (seconds & 0x00000000000FF000) >> (3 * 4);
-	ubuf[3] = (seconds & 0x0000000000000FF0) >> (1 * 4);
-	ubuf[4] = (((seconds & 0x000000000000000F) << (1 * 4))
-		   | ((hifrac & 0x0F00) >> (2 * 4)));
-	ubuf[5] = (hifrac & 0x00FF);
-	ubuf[6] = (((uuid7_version & 0x0F) << 4)
-		   | ((lofrac & 0x0F00) >> (2 * 4)));
-	ubuf[7] = (lofrac & 0x00FF);
-	ubuf[8] = ((uuid7_variant & 0x03) << 6) | hiseq;
-	ubuf[9] = 0x00;
-	ubuf[10] = ((segment & 0xFF00) >> 8);
-	ubuf[11] = ((segment & 0x00FF));
-	ubuf[12] = (random_bytes & 0x00000000000000FF) >> (0 * 8);
-	ubuf[13] = (random_bytes & 0x000000000000FF00) >> (1 * 8);
-	ubuf[14] = (random_bytes & 0x0000000000FF0000) >> (2 * 8);
-	ubuf[15] = (random_bytes & 0x00000000FF000000) >> (3 * 8);
+#ifdef UUID7_TSC
+#include <stdatomic.h>
+struct uuid7_tsc_anchor {
+	uint64_t tsc;
+	/* the time stamped at tsc, and the clock at tsc */
+	uint64_t ns;
+	uint64_t clock_ns;
+	/* nanoseconds per tick, times 2^32; zero until calibrated */
+	uint64_t mult;
+	/* the ticks after tsc until the clock is to be read again */
+	uint64_t ticks;
+};
 
-#ifdef UUID7_WITH_MUTEX
-	if (uuid7_mutex_initd) {
-		mtx_lock(&uuid7_mutex);
-	}
+static struct {
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) _Atomic unsigned seq;
+	/* 0 until checked, then 1 if the counter is usable, else -1 */
+	_Atomic int usable;
+	_Atomic uint64_t tsc;
+	_Atomic uint64_t ns;
+	_Atomic uint64_t clock_ns;
+	_Atomic uint64_t mult;
+	_Atomic uint64_t ticks;
+	_Atomic int64_t drift_ns;
+} uuid7_tsc;
 #endif
 
-	/* the first 9 bytes contain the seconds and the fraction */
-	static_assert((9 * 8) == (36 + 12 + 4 + 12 + 2 + 6));
-	int cmp = memcmp(last_issued, ubuf, 9);
-	if (cmp > 0) {
-		/*
-		   Sadly, we've gone backwards in time.
-		   The caller will have to try again when time catches up
-
-		   If they are very chummy with the library,
-		   they can declare, and call a non-API "friend" function:
-		   void uuid7_reset(void);
-		   and then call that before re-trying.
-		 */
-		goto uuid7_next_end;
-	}
-	if (cmp == 0) {
-		uint16_t seq = 1 + last_issued[9];
-		if (seq <= 0xFF) {
-			ubuf[9] = seq;
-		} else {
-			ubuf[9] = 0xFF;
-			/*
-			   A 10 Ghz CPU is 10 cycles per nanosecond.
-			   Even with multiple instructions per cycle,
-			   more than 16383 in the same 64 nanoseconds
-			   suggests something is wrong with the clockid
+/*
+   Counts are kept per-thread, and added to the process-wide totals with
+   relaxed atomics every UUID7_STATS_FLUSH calls, or upon any failure,
+   thus the totals may lag behind the most recent calls of other threads.
+*/
+enum uuid7_stat {
+	UUID7_STAT_CALLS,
+	UUID7_STAT_SUCCESSES,
+	UUID7_STAT_UUIDS,
+	UUID7_STAT_CLOCK_FAILURES,
+	UUID7_STAT_RANDOM_FAILURES,
+	UUID7_STAT_BACKWARDS,
+	UUID7_STAT_SEQ_EXHAUSTED,
+	UUID7_STAT_SEQ_OVERFLOWS,
+	UUID7_STAT_BORROWED,
+	UUID7_STAT_TSC_ANCHORS,
+	/* the rest are maximums rather than sums */
+	UUID7_STAT_MAX_SEQ,
+	UUID7_STAT_MAX_BACKWARDS_NS,
+	UUID7_STAT_MAX_TSC_DRIFT_NS,
+	UUID7_STAT_LEN
+};
+#ifndef UUID7_NO_STATS
+#ifndef UUID7_STATS_FLUSH
+#define UUID7_STATS_FLUSH 64
+#endif
+#if (UUID7_NO_THREADS)
+static struct {
+	uint64_t total[UUID7_STAT_LEN];
+} uuid7_stats;
+static uint64_t uuid7_stats_pending[UUID7_STAT_LEN];
+#else
+#include <stdatomic.h>
+#include <stdbool.h>
+/* each flush writes the totals, thus they are on lines of their own */
+static struct {
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) _Atomic uint64_t total[UUID7_STAT_LEN];
+} uuid7_stats;
+static thread_local uint64_t uuid7_stats_pending[UUID7_STAT_LEN];
+/* a thread-specific key, so that a thread's counts are added at exit */
+static thread_local bool uuid7_stats_registered = false;
+static tss_t uuid7_stats_key;
+static int uuid7_stats_key_rv = -1;
+static once_flag uuid7_stats_once = ONCE_FLAG_INIT;
+#endif
+#define uuid7_stat_add(stat, n) (uuid7_stats_pending[stat] += (n))
+#define uuid7_stat_max(stat, v) \
+	do { \
+		if ((v) > uuid7_stats_pending[stat]) { \
+			uuid7_stats_pending[stat] = (v); \
+		} \
+	} while (0)
+#else
+#define uuid7_stat_add(stat, n) ((void)(n))
+#define uuid7_stat_max(stat, v) ((void)0)
+#endif
 
-			   Perhaps the caller will be lucky and the
-			   random bits will sort naturally, we shall see
-			 */
-			if (memcmp(last_issued, ubuf, 16) >= 0) {
-				/* the caller was NOT lucky, this is a fail */
-				goto uuid7_next_end;
+void uuid7_stats_flush(void)
+{
+#ifndef UUID7_NO_STATS
+	for (size_t i = 0; i < UUID7_STAT_LEN; ++i) {
+		uint64_t v = uuid7_stats_pending[i];
+		uuid7_stats_pending[i] = 0;
+#if (UUID7_NO_THREADS)
+		if (i < UUID7_STAT_MAX_SEQ) {
+			uuid7_stats.total[i] += v;
+		} else if (v > uuid7_stats.total[i]) {
+			uuid7_stats.total[i] = v;
+		}
+#else
+		_Atomic uint64_t *total = &uuid7_stats.total[i];
+		if (i < UUID7_STAT_MAX_SEQ) {
+			if (v) {
+				atomic_fetch_add_explicit(total, v,
+							  memory_order_relaxed);
 			}
+			continue;
 		}
+		memory_order relaxed = memory_order_relaxed;
+		uint64_t old = atomic_load_explicit(total, relaxed);
+		while (v > old
+		       && !atomic_compare_exchange_weak_explicit(total, &old, v,
+								 relaxed,
+								 relaxed)) {
+			/* old now holds the current value, try again */
+		}
+#endif
 	}
+#endif
+}
 
-	void *dest = memcpy(last_issued, ubuf, 16);
-	assert(dest);
-	(void)dest;
-
-	success = 1;
+#if (!defined(UUID7_NO_STATS) && !UUID7_NO_THREADS)
+static void uuid7_stats_at_exit(void *unused)
+{
+	(void)unused;
+	uuid7_stats_flush();
+}
 
-uuid7_next_end:
+static void uuid7_stats_key_create(void)
+{
+	uuid7_stats_key_rv = tss_create(&uuid7_stats_key, uuid7_stats_at_exit);
+}
 
-#ifdef UUID7_WITH_MUTEX
-	if (uuid7_mutex_initd) {
-		mtx_unlock(&uuid7_mutex);
+static void uuid7_stats_register(void)
+{
+	call_once(&uuid7_stats_once, uuid7_stats_key_create);
+	if (uuid7_stats_key_rv == thrd_success) {
+		/* the destructor is only called for a non-NULL value */
+		tss_set(uuid7_stats_key, &uuid7_stats_registered);
 	}
+	uuid7_stats_registered = true;
+}
 #endif
 
-	if (!success) {
-		memset(ubuf, 0x00, 16);
-		return NULL;
+static uint64_t uuid7_stats_read(size_t i)
+{
+#ifdef UUID7_NO_STATS
+	(void)i;
+	return 0;
+#elif (UUID7_NO_THREADS)
+	return uuid7_stats.total[i];
+#else
+	return atomic_load_explicit(&uuid7_stats.total[i],
+				    memory_order_relaxed);
+#endif
+}
+
+struct uuid7_stats *uuid7_stats_get(struct uuid7_stats *stats)
+{
+	assert(stats);
+	uuid7_stats_flush();
+	stats->calls = uuid7_stats_read(UUID7_STAT_CALLS);
+	stats->successes = uuid7_stats_read(UUID7_STAT_SUCCESSES);
+	stats->uuids = uuid7_stats_read(UUID7_STAT_UUIDS);
+	stats->clock_failures = uuid7_stats_read(UUID7_STAT_CLOCK_FAILURES);
+	stats->random_failures = uuid7_stats_read(UUID7_STAT_RANDOM_FAILURES);
+	stats->backwards = uuid7_stats_read(UUID7_STAT_BACKWARDS);
+	stats->seq_exhausted = uuid7_stats_read(UUID7_STAT_SEQ_EXHAUSTED);
+	stats->seq_overflows = uuid7_stats_read(UUID7_STAT_SEQ_OVERFLOWS);
+	stats->borrowed = uuid7_stats_read(UUID7_STAT_BORROWED);
+	stats->max_seq = uuid7_stats_read(UUID7_STAT_MAX_SEQ);
+	stats->max_backwards_ns = uuid7_stats_read(UUID7_STAT_MAX_BACKWARDS_NS);
+	stats->tsc_anchors = uuid7_stats_read(UUID7_STAT_TSC_ANCHORS);
+	stats->max_tsc_drift_ns = uuid7_stats_read(UUID7_STAT_MAX_TSC_DRIFT_NS);
+#ifdef UUID7_TSC
+	stats->tsc_drift_ns = atomic_load(&uuid7_tsc.drift_ns);
+#else
+	stats->tsc_drift_ns = 0;
+#endif
+	return stats;
+}
+
+/* zeros the totals, and the pending counts of only the calling thread */
+void uuid7_stats_reset(void)
+{
+#ifndef UUID7_NO_STATS
+	for (size_t i = 0; i < UUID7_STAT_LEN; ++i) {
+		uuid7_stats_pending[i] = 0;
+#if (UUID7_NO_THREADS)
+		uuid7_stats.total[i] = 0;
+#else
+		atomic_store_explicit(&uuid7_stats.total[i], 0,
+				      memory_order_relaxed);
+#endif
 	}
+#endif
+}
 
-	return ubuf;
+/* counts a call to the API, returning rv */
+static uint8_t *uuid7_stats_done(uint8_t *rv, size_t count)
+{
+	uuid7_stat_add(UUID7_STAT_CALLS, 1);
+	if (rv) {
+		uuid7_stat_add(UUID7_STAT_SUCCESSES, 1);
+		uuid7_stat_add(UUID7_STAT_UUIDS, count);
+	}
+#if (!defined(UUID7_NO_STATS) && !UUID7_NO_THREADS)
+	if (!uuid7_stats_registered) {
+		uuid7_stats_register();
+	}
+#endif
+#ifndef UUID7_NO_STATS
+	if (!rv || uuid7_stats_pending[UUID7_STAT_CALLS] >= UUID7_STATS_FLUSH) {
+		uuid7_stats_flush();
+	}
+#endif
+	return rv;
 }
 
-struct uuid7 *uuid7_parts(struct uuid7 *u, const uint8_t *bytes)
+static uint64_t uuid7_ns_of_ts(struct timespec ts)
 {
-	assert(u);
-	assert(bytes);
+	return (((uint64_t)ts.tv_sec) * 1000000000) + ts.tv_nsec;
+}
 
-	u->seconds = ((((uint64_t)bytes[0]) << (7 * 4))
-		      | (((uint64_t)bytes[1]) << (5 * 4))
-		      | (((uint64_t)bytes[2]) << (3 * 4))
-		      | (((uint64_t)bytes[3]) << (1 * 4))
-		      | (((uint64_t)bytes[4]) >> (1 * 4)));
+static int uuid7_clock_now(clockid_t clockid, struct timespec *ts)
+{
+	if (uuid7_clock_gettime(clockid, ts)) {
+		uuid7_stat_add(UUID7_STAT_CLOCK_FAILURES, 1);
+		return -1;
+	}
+	return 0;
+}
 
-	u->hifrac = ((((uint16_t)bytes[4] & 0x0F) << 8) | bytes[5]);
-	u->uuid_ver = (bytes[6] & 0xF0) >> 4;
-	u->lofrac = (((uint16_t)(bytes[6] & 0x0F)) << 8) | bytes[7];
-	u->uuid_var = (bytes[8] & 0xC0) >> 6;
-	u->hiseq = bytes[8] & 0x3F;
-	u->loseq = bytes[9];
-	u->segment = (((uint16_t)bytes[10]) << 8) | bytes[11];
+#ifdef UUID7_TSC
+/*
+   Rather than a call to clock_gettime for each UUID, the time is derived
+   from the invariant TSC (or CNTVCT on aarch64): stamp = anchor ns + the
+   ticks since the anchor, times the nanoseconds per tick, which are
+   calibrated against the clock over the first UUID7_TSC_CALIBRATE_NS.
+   After UUID7_TSC_PERIOD_NS the clock is read again, the difference is
+   kept as the drift, and a new anchor is set, never behind the time
+   already stamped: if the TSC ran ahead of the clock, the rate is slowed
+   until the clock catches up. If there is no invariant counter, or while
+   calibrating, the clock is read as usual.
 
-	u->rand = (((uint64_t)bytes[15]) << (8 * 3))
-	    | (((uint64_t)bytes[14]) << (8 * 2))
-	    | (((uint64_t)bytes[13]) << (8 * 1))
-	    | (((uint64_t)bytes[12]) << (8 * 0));
+   The anchor is shared by all threads, guarded by a sequence count which
+   is odd while the anchor is re-written; a reader which sees a write in
+   progress simply reads the clock.
+*/
 
-	return u->uuid_ver == uuid7_version && u->uuid_var == uuid7_variant
-	    ? u : NULL;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <x86intrin.h>
+static uint64_t uuid7_rdtsc(void)
+{
+	return __rdtsc();
 }
 
-uint8_t *uuid7(uint8_t *ubuf)
+/* CPUID.80000007H:EDX[8], the TSC runs at a constant rate in all states */
+static int uuid7_tsc_invariant(void)
 {
-	struct timespec ts;
-	if (uuid7_clock_gettime(uuid7_clockid, &ts)) {
-		memset(ubuf, 0x00, 16);
-		return NULL;
+	unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+		return 0;
 	}
+	return (edx >> 8) & 1;
+}
+#elif defined(__GNUC__) && defined(__aarch64__)
+static uint64_t uuid7_rdtsc(void)
+{
+	uint64_t cntvct;
+	__asm__ volatile ("isb; mrs %0, cntvct_el0":"=r" (cntvct));
+	return cntvct;
+}
 
-	uint64_t random_bytes = 0;
-	size_t size = sizeof(random_bytes);
-	unsigned int flags = 0;
-	ssize_t rndbytes = uuid7_getrandom(&random_bytes, size, flags);
-	if (rndbytes < 0 || ((size_t)rndbytes != size)) {
-		memset(ubuf, 0x00, 16);
-		return NULL;
-	}
-#ifdef UUID7_WITH_MUTEX
-	/* everything is mutexed, there is no segmenting */
-	uint16_t segment = (uint16_t)(random_bytes >> (4 * 8));
-#elif UUID7_NO_THREADS
-	/* there is only one thread, there is no segmenting */
-	uint16_t segment = (uint16_t)(random_bytes >> (4 * 8));
+/* the generic timer always counts at a constant rate */
+static int uuid7_tsc_invariant(void)
+{
+	return 1;
+}
 #else
-	/* segment by address of thread_local */
-	uint16_t segment = u16_from_u64_xor((uint64_t) uuid7_last);
+static uint64_t uuid7_rdtsc(void)
+{
+	return 0;
+}
+
+static int uuid7_tsc_invariant(void)
+{
+	return 0;
+}
 #endif
 
-	uint32_t rand32 = (0xFFFFFFFF & random_bytes);
-	return uuid7_next(ubuf, ts, segment, rand32, uuid7_last);
+/* for UUID7_DEBUG, allow swapping the counter at runtime */
+#ifdef UUID7_DEBUG
+uint64_t (*uuid7_tsc_read)(void) = uuid7_rdtsc;
+int (*uuid7_tsc_check)(void) = uuid7_tsc_invariant;
+#else
+#define uuid7_tsc_read uuid7_rdtsc
+#define uuid7_tsc_check uuid7_tsc_invariant
+#endif
+
+static int uuid7_tsc_load(struct uuid7_tsc_anchor *a)
+{
+	memory_order relaxed = memory_order_relaxed;
+	memory_order acquire = memory_order_acquire;
+	unsigned seq = atomic_load_explicit(&uuid7_tsc.seq, acquire);
+	a->tsc = atomic_load_explicit(&uuid7_tsc.tsc, relaxed);
+	a->ns = atomic_load_explicit(&uuid7_tsc.ns, relaxed);
+	a->clock_ns = atomic_load_explicit(&uuid7_tsc.clock_ns, relaxed);
+	a->mult = atomic_load_explicit(&uuid7_tsc.mult, relaxed);
+	a->ticks = atomic_load_explicit(&uuid7_tsc.ticks, relaxed);
+	atomic_thread_fence(acquire);
+	return !(seq & 1) && (seq == atomic_load_explicit(&uuid7_tsc.seq,
+							  relaxed));
 }
 
-static char uuid7_nibble_to_hex(uint8_t nib)
+/* if another thread is already re-anchoring, its anchor will do */
+static void uuid7_tsc_store(const struct uuid7_tsc_anchor *a)
 {
-	assert(nib < 16);
-	char rv = 0;
-	rv = (nib < 10) ? '0' + nib : 'a' + (nib - 10);
-	assert((rv >= '0' && rv <= '9') || (rv >= 'a' && rv <= 'f'));
-	return rv;
+	memory_order relaxed = memory_order_relaxed;
+	unsigned seq = atomic_load_explicit(&uuid7_tsc.seq, relaxed);
+	if ((seq & 1)
+	    || !atomic_compare_exchange_strong(&uuid7_tsc.seq, &seq, seq + 1)) {
+		return;
+	}
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&uuid7_tsc.tsc, a->tsc, relaxed);
+	atomic_store_explicit(&uuid7_tsc.ns, a->ns, relaxed);
+	atomic_store_explicit(&uuid7_tsc.clock_ns, a->clock_ns, relaxed);
+	atomic_store_explicit(&uuid7_tsc.mult, a->mult, relaxed);
+	atomic_store_explicit(&uuid7_tsc.ticks, a->ticks, relaxed);
+	atomic_store_explicit(&uuid7_tsc.seq, seq + 2, memory_order_release);
 }
 
-static size_t uuid7_minz(size_t a, size_t b)
+/* a friend function, the next UUID checks and calibrates again */
+void uuid7_tsc_reset(void)
 {
-	return (a < b) ? a : b;
+	struct uuid7_tsc_anchor zero;
+	memset(&zero, 0x00, sizeof(zero));
+	uuid7_tsc_store(&zero);
+	atomic_store(&uuid7_tsc.drift_ns, 0);
+	atomic_store(&uuid7_tsc.usable, 0);
 }
 
-/* 8-4-4-4-12 */
-char *uuid7_to_string(char *buf, size_t buf_size, const uint8_t *bytes)
+static int uuid7_tsc_usable(void)
 {
-	assert(buf);
-	const size_t uuid_str_size = ((16 * 2) + 4) + 1;
-	memset(buf, 0x00, uuid7_minz(uuid_str_size, buf_size));
-	if (buf_size < uuid_str_size) {
-		return NULL;
+	int usable = atomic_load_explicit(&uuid7_tsc.usable,
+					  memory_order_relaxed);
+	if (!usable) {
+		usable = uuid7_tsc_check() ? 1 : -1;
+		atomic_store_explicit(&uuid7_tsc.usable, usable,
+				      memory_order_relaxed);
 	}
-	size_t pos = 0;
-	for (size_t i = 0; i < 16; ++i) {
-		uint8_t byte = bytes[i];
-		uint8_t hi_nib = ((byte & 0xF0) >> 4);
-		uint8_t lo_nib = (byte & 0x0F);
-		buf[pos++] = uuid7_nibble_to_hex(hi_nib);
-		buf[pos++] = uuid7_nibble_to_hex(lo_nib);
-		switch (i) {
-		case 3:
-		case 3 + 2:
-		case 3 + 2 + 2:
-		case 3 + 2 + 2 + 2:
-			buf[pos++] = '-';
+	return usable > 0;
+}
+
+static struct timespec uuid7_ts_of_ns(uint64_t ns)
+{
+	struct timespec ts;
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	return ts;
+}
+
+static uint64_t uuid7_tsc_ticks(uint64_t mult)
+{
+	return (((uint64_t)UUID7_TSC_PERIOD_NS) << 32) / mult;
+}
+
+/*
+   With the clock read at tsc, returns the time to stamp, and moves the
+   anchor to tsc: the first anchor, the end of calibration, or the end of
+   a period.
+*/
+static uint64_t uuid7_tsc_anchor(struct uuid7_tsc_anchor *a, uint64_t tsc,
+				 uint64_t clock_ns)
+{
+	uint64_t elapsed_ns = clock_ns - a->clock_ns;
+	uint64_t elapsed_ticks = tsc - a->tsc;
+	int backwards = (clock_ns < a->clock_ns) || (tsc < a->tsc);
+
+	if (!a->tsc || backwards) {
+		a->tsc = tsc;
+		a->ns = clock_ns;
+		a->clock_ns = clock_ns;
+		a->mult = 0;
+		uuid7_tsc_store(a);
+		return clock_ns;
+	}
+
+	if (!a->mult) {
+		if (elapsed_ns < UUID7_TSC_CALIBRATE_NS || !elapsed_ticks) {
+			return clock_ns;
 		}
+		a->tsc = tsc;
+		a->ns = clock_ns;
+		a->clock_ns = clock_ns;
+		a->mult = (elapsed_ns << 32) / elapsed_ticks;
+		a->mult = a->mult ? a->mult : 1;
+		a->ticks = uuid7_tsc_ticks(a->mult);
+		uuid7_tsc_store(a);
+		return clock_ns;
 	}
-	return buf;
+
+	uint64_t ns = clock_ns;
+	int64_t drift = 0;
+	/* after a long idle, or a step of the clock, start from the clock */
+	if (elapsed_ticks <= (2 * a->ticks)
+	    && elapsed_ns <= (4 * (uint64_t)UUID7_TSC_PERIOD_NS)) {
+		uint64_t stamped = a->ns + ((elapsed_ticks * a->mult) >> 32);
+		drift = (int64_t)(clock_ns - stamped);
+		a->mult = (elapsed_ns << 32) / elapsed_ticks;
+		a->mult = a->mult ? a->mult : 1;
+		uint64_t ahead = (stamped > clock_ns) ? stamped - clock_ns : 0;
+		if (ahead && ahead <= UUID7_TSC_PERIOD_NS) {
+			/* do not step back, but slow, at most by half */
+			ns = stamped;
+			uint64_t ticks = uuid7_tsc_ticks(a->mult);
+			uint64_t slow = (ahead << 32) / ticks;
+			a->mult -= uuid7_minz(slow, a->mult / 2);
+		}
+	}
+	uuid7_stat_add(UUID7_STAT_TSC_ANCHORS, 1);
+	uuid7_stat_max(UUID7_STAT_MAX_TSC_DRIFT_NS,
+		       (drift < 0) ? -(uint64_t)drift : (uint64_t)drift);
+	atomic_store_explicit(&uuid7_tsc.drift_ns, drift, memory_order_relaxed);
+
+	a->tsc = tsc;
+	a->ns = ns;
+	a->clock_ns = clock_ns;
+	a->ticks = uuid7_tsc_ticks(a->mult);
+	uuid7_tsc_store(a);
+	return ns;
+}
+
+static int uuid7_tsc_now(struct timespec *ts)
+{
+	if (!uuid7_tsc_usable()) {
+		return uuid7_clock_now(uuid7_clockid, ts);
+	}
+
+	uint64_t tsc = uuid7_tsc_read();
+	struct uuid7_tsc_anchor a;
+	int loaded = uuid7_tsc_load(&a);
+	if (loaded && a.mult && (tsc >= a.tsc) && ((tsc - a.tsc) < a.ticks)) {
+		*ts = uuid7_ts_of_ns(a.ns + (((tsc - a.tsc) * a.mult) >> 32));
+		return 0;
+	}
+
+	if (uuid7_clock_now(uuid7_clockid, ts)) {
+		return -1;
+	}
+	if (loaded) {
+		*ts = uuid7_ts_of_ns(uuid7_tsc_anchor(&a, tsc,
+						      uuid7_ns_of_ts(*ts)));
+	}
+	return 0;
+}
+#endif
+
+static int uuid7_now(struct timespec *ts)
+{
+#ifdef UUID7_TSC
+	return uuid7_tsc_now(ts);
+#else
+	return uuid7_clock_now(uuid7_clockid, ts);
+#endif
+}
+
+/* ceiling of log base 2, e.g. 1000 ns needs 10 bits */
+static unsigned uuid7_log2_ceil(uint64_t n)
+{
+	unsigned bits = 0;
+	while ((bits < 63) && ((1ULL << bits) < n)) {
+		++bits;
+	}
+	return bits;
+}
+
+/*
+   The bits of the nanoseconds below the tick of the clock are the same
+   in every read: the tick is at least the resolution, and if some reads
+   returned the same time as the read before, at least the smallest step
+   between reads.
+*/
+static unsigned uuid7_clock_tick_bits(const struct uuid7_clock_info *info,
+				      uint32_t varying)
+{
+	uint64_t tick = info->resolution_ns;
+	if (info->duplicates && (info->step_ns > tick)) {
+		tick = info->step_ns;
+	}
+	unsigned constant = uuid7_log2_ceil(tick);
+	while ((constant < 30) && !(varying & (1UL << constant))) {
+		++constant;
+	}
+	return (constant > 30) ? 30 : constant;
+}
+
+int uuid7_clock_probe(clockid_t clockid, struct uuid7_clock_info *info)
+{
+	assert(info);
+	memset(info, 0x00, sizeof(struct uuid7_clock_info));
+
+	struct timespec res;
+	struct timespec first;
+	if (clock_getres(clockid, &res)
+	    || uuid7_clock_gettime(clockid, &first)) {
+		return -1;
+	}
+
+	uint64_t prev = uuid7_ns_of_ts(first);
+	uint64_t step_ns = 0;
+	unsigned duplicates = 0;
+	uint32_t varying = 0;
+	for (size_t i = 0; i < UUID7_CLOCK_PROBE_SAMPLES; ++i) {
+		struct timespec ts;
+		if (uuid7_clock_gettime(clockid, &ts)) {
+			return -1;
+		}
+		uint64_t ns = uuid7_ns_of_ts(ts);
+		if (ns == prev) {
+			++duplicates;
+		} else if ((ns > prev) && (!step_ns || (ns - prev) < step_ns)) {
+			step_ns = ns - prev;
+		}
+		varying |= (uint32_t)(ts.tv_nsec ^ first.tv_nsec);
+		prev = ns;
+	}
+
+	info->clockid = clockid;
+	info->resolution_ns = uuid7_ns_of_ts(res);
+	info->samples = UUID7_CLOCK_PROBE_SAMPLES;
+	info->duplicates = duplicates;
+	info->step_ns = step_ns;
+	info->tick_bits = uuid7_clock_tick_bits(info, varying);
+	/* the hiseq holds the lowest 6 bits of the nanoseconds */
+	info->hiseq_bits = (info->tick_bits >= 6) ? 0 : (6 - info->tick_bits);
+	return 0;
+}
+
+/* of the clock last set, or probed on first request */
+static struct uuid7_clock_info uuid7_clock_info_last;
+
+#ifdef UUID7_ADAPTIVE_SEQ
+static unsigned uuid7_seq_bits_of(const struct uuid7_clock_info *info)
+{
+	return (info->tick_bits > UUID7_ADAPTIVE_SEQ_MAX_BITS)
+	    ? UUID7_ADAPTIVE_SEQ_MAX_BITS : info->tick_bits;
+}
+#endif
+
+/* the bits of the nanoseconds which extend the sequence, if any */
+static unsigned uuid7_seq_bits(void)
+{
+#ifdef UUID7_ADAPTIVE_SEQ
+	int bits = uuid7_seq_bits_probed;
+	if (bits < 0) {
+		/* if the clock can not be read, the info is zeroed */
+		struct uuid7_clock_info info;
+		uuid7_clock_probe(uuid7_clockid, &info);
+		bits = (int)uuid7_seq_bits_of(&info);
+		uuid7_seq_bits_probed = bits;
+	}
+	return (unsigned)bits;
+#else
+	return 0;
+#endif
+}
+
+int uuid7_set_clock(clockid_t clockid)
+{
+	struct uuid7_clock_info info;
+	if (uuid7_clock_probe(clockid, &info)) {
+		return -1;
+	}
+	uuid7_clock_info_last = info;
+	uuid7_clockid = clockid;
+#ifdef UUID7_ADAPTIVE_SEQ
+	uuid7_seq_bits_probed = (int)uuid7_seq_bits_of(&info);
+#endif
+#ifdef UUID7_TSC
+	/* anchored to the old clock, thus calibrate again */
+	uuid7_tsc_reset();
+#endif
+	return 0;
+}
+
+clockid_t uuid7_get_clock(struct uuid7_clock_info *info)
+{
+	if (info) {
+		if (!uuid7_clock_info_last.samples
+		    || (uuid7_clock_info_last.clockid != uuid7_clockid)) {
+			uuid7_clock_probe(uuid7_clockid,
+					  &uuid7_clock_info_last);
+		}
+		*info = uuid7_clock_info_last;
+	}
+	return uuid7_clockid;
+}
+
+/*
+   takes a uint64_t and returns uint16_t
+   return value is computed by breaking the 64-bit input
+   into four 16-bit blocks and XORing the blocks together.
+*/
+#define u16_from_u64_xor(in) \
+	((uint16_t)(	((in >> (16 * 3)) & 0xFFFF) \
+		^	((in >> (16 * 2)) & 0xFFFF) \
+		^	((in >> (16 * 1)) & 0xFFFF) \
+		^	((in >> (16 * 0)) & 0xFFFF) \
+	))
+
+/*
+   Of uuid7_set_segment: the mask of the fixed bits of the segment in the
+   high 16 bits, and the fixed bits in the low 16. Zero is none fixed.
+*/
+static uint32_t uuid7_segment_node = 0;
+
+static uint16_t uuid7_segment_fix(uint16_t segment)
+{
+	uint16_t mask = (uint16_t)(uuid7_segment_node >> 16);
+	return (uint16_t)((segment & ~mask) | (uuid7_segment_node & mask));
+}
+
+int uuid7_set_segment(uint16_t node, unsigned bits)
+{
+	if (bits > 16 || (bits < 16 && (node >> bits))) {
+		return -1;
+	}
+	uint32_t mask = (0xFFFF0000 >> bits) & 0xFFFF;
+	uuid7_segment_node = (mask << 16) | ((uint32_t)node << (16 - bits));
+	return 0;
+}
+
+#ifndef ARDUINO
+#include <errno.h>
+int uuid7_set_segment_env(void)
+{
+	const char *str = getenv("UUID7_SEGMENT");
+	if (!str || !*str) {
+		return 0;
+	}
+	char *end = NULL;
+	errno = 0;
+	unsigned long node = strtoul(str, &end, 0);
+	unsigned long bits = 16;
+	int invalid = (end == str);
+	if (!invalid && *end == '/') {
+		const char *bits_str = end + 1;
+		bits = strtoul(bits_str, &end, 10);
+		invalid = (end == bits_str);
+	}
+	if (invalid || errno || *end || node > 0xFFFF || bits > 16
+	    || uuid7_set_segment((uint16_t)node, (unsigned)bits)) {
+		return -1;
+	}
+	return 1;
+}
+#endif
+
+/*
+   If the clock has gone backwards in time by a large amount,
+   the system may not catch up in a reasonable time, and thus
+   it may be more desirable to generate UUIDs that would sort
+   prior to UUIDs already generated.
+
+   In that situation, uuid7_reset can be used.
+
+   However, if not UUID7_WITH_MUTEX, UUID7_WITH_ATOMIC, UUID7_PER_CPU
+   and not UUID7_NO_THREADS, then this will need to be called for each
+   thread which has already set the thread_local uuid7_last, or else
+   uuid7_reset_all called once, from any thread.
+*/
+#ifdef UUID7_PER_CPU
+static void uuid7_cpu_slot_lock(struct uuid7_cpu_slot *slot)
+{
+	while (atomic_exchange_explicit(&slot->busy, true,
+					memory_order_acquire)) {
+		thrd_yield();
+	}
+}
+
+static void uuid7_cpu_slot_unlock(struct uuid7_cpu_slot *slot)
+{
+	atomic_store_explicit(&slot->busy, false, memory_order_release);
+}
+#endif
+
+void uuid7_reset(void)
+{
+#ifdef UUID7_WITH_MUTEX
+	if (uuid7_locked.initd) {
+		mtx_lock(&uuid7_locked.mutex);
+	}
+#endif
+
+#ifdef UUID7_WITH_ATOMIC
+	atomic_store(&uuid7_last_key.key, 0);
+#elif defined(UUID7_PER_CPU)
+	/* every slot, whichever CPU the caller happens to be on */
+	for (size_t i = 0; i < UUID7_MAX_CPUS; ++i) {
+		uuid7_cpu_slot_lock(&uuid7_cpu_slots[i]);
+		memset(uuid7_cpu_slots[i].last, 0x00, 16);
+		uuid7_cpu_slot_unlock(&uuid7_cpu_slots[i]);
+	}
+#else
+	memset(uuid7_last, 0x00, 16);
+#endif
+
+#ifdef UUID7_WITH_MUTEX
+	if (uuid7_locked.initd) {
+		mtx_unlock(&uuid7_locked.mutex);
+	}
+#endif
+}
+
+void uuid7_reset_all(void)
+{
+#if (UUID7_NO_THREADS)
+	++uuid7_epoch;
+#else
+	atomic_fetch_add_explicit(&uuid7_epoch, 1, memory_order_relaxed);
+#endif
+	uuid7_reset();
+#ifdef UUID7_LAST_THREAD_LOCAL
+	uuid7_last_epoch = uuid7_epoch_now();
+#endif
+}
+
+#ifdef UUID7_LAST_THREAD_LOCAL
+/* resets the uuid7_last of this thread if uuid7_reset_all has been called */
+static void uuid7_last_epoch_check(void)
+{
+	unsigned epoch = uuid7_epoch_now();
+	if (uuid7_last_epoch != epoch) {
+		memset(uuid7_last, 0x00, 16);
+		uuid7_last_epoch = epoch;
+	}
+}
+#endif
+
+/* resets the generator if uuid7_reset_all has been called */
+static void uuid7_gen_epoch_check(struct uuid7_gen *gen)
+{
+	unsigned epoch = uuid7_epoch_now();
+	if (gen->epoch != epoch) {
+		memset(gen->last, 0x00, 16);
+		gen->epoch = epoch;
+	}
+}
+
+static void uuid7_entropy_clear(struct uuid7_entropy_buf *entropy)
+{
+	if (entropy->bytes) {
+		memset(entropy->bytes, 0x00, entropy->size);
+	}
+	entropy->pos = 0;
+	entropy->len = 0;
+	entropy->fork_generation = uuid7_fork_generation;
+	entropy->refills = 0;
+}
+
+#ifdef UUID7_ENTROPY_POOL
+/*
+   Discards any buffered random bytes of the calling thread's pool,
+   the next UUID will request a fresh chunk.
+*/
+void uuid7_entropy_reset(void)
+{
+	uuid7_entropy_clear(&uuid7_pool);
+}
+#elif defined(UUID7_FAST_RANDOM)
+/* Discards the state of the calling thread, the next UUID will reseed */
+void uuid7_entropy_reset(void)
+{
+	memset(&uuid7_xoshiro, 0x00, sizeof(uuid7_xoshiro));
+}
+#endif
+
+#include <assert.h>
+/*
+#ifndef static_assert
+#define static_assert _Static_assert
+#endif
+*/
+static_assert(sizeof(struct uuid7) == 16);
+#if !defined(UUID7_WITH_ATOMIC) && !defined(UUID7_PER_CPU)
+static_assert(sizeof(uuid7_last) == 16);
+#endif
+
+const uint8_t uuid7_version = UUID7_VERSION;
+const uint8_t uuid7_variant = UUID7_VARIANT;
+
+/*
+   The layout of a UUID is told by the variant. Of the layout of the
+   python docs, the sequence is the 8 bits of byte 9, after a 72 bit
+   prefix of the timestamp. Of the RFC 9562 layout, the sequence is the
+   14 bit counter of bytes 8 and 9, after the 64 bits of the timestamp.
+*/
+static int uuid7_is_rfc9562(const uint8_t *bytes)
+{
+	return ((bytes[8] & 0xC0) >> 6) == UUID7_VARIANT_RFC9562;
+}
+
+static size_t uuid7_prefix_len(const uint8_t *bytes)
+{
+	return uuid7_is_rfc9562(bytes) ? 8 : 9;
+}
+
+static uint16_t uuid7_seq_of(const uint8_t *bytes)
+{
+	if (uuid7_is_rfc9562(bytes)) {
+		return (((uint16_t)(bytes[8] & 0x3F)) << 8) | bytes[9];
+	}
+	return bytes[9];
+}
+
+static uint16_t uuid7_seq_max(const uint8_t *bytes)
+{
+	return uuid7_is_rfc9562(bytes) ? 0x3FFF : 0xFF;
+}
+
+static void uuid7_seq_set(uint8_t *bytes, uint16_t seq)
+{
+	if (uuid7_is_rfc9562(bytes)) {
+		bytes[8] = (bytes[8] & 0xC0) | ((seq >> 8) & 0x3F);
+	}
+	bytes[9] = (seq & 0xFF);
+}
+
+static void uuid7_pack_as(uint8_t *ubuf, struct timespec ts,
+			  uint16_t segment, uint32_t random_bytes,
+			  unsigned layout)
+{
+	if (layout == UUID7_LAYOUT_RFC9562) {
+		uuid7_pack_rfc9562(ubuf, ts, segment, random_bytes);
+	} else {
+		uuid7_pack(ubuf, ts, segment, random_bytes);
+	}
+}
+
+/* the start of the following nanosecond, or 1/4096 ms for RFC 9562 */
+static struct timespec uuid7_next_tick(struct timespec ts, unsigned layout)
+{
+	if (layout == UUID7_LAYOUT_RFC9562) {
+		uint32_t ms = ts.tv_nsec / 1000000;
+		uint32_t sub = ts.tv_nsec % 1000000;
+		uint32_t subms = 1 + ((sub * 4096) / 1000000);
+		if (subms == 4096) {
+			subms = 0;
+			++ms;
+		}
+		/* rounded up, to be within the 1/4096 ms */
+		sub = ((subms * 1000000) + 4095) / 4096;
+		ts.tv_nsec = (ms * 1000000) + sub;
+		if (ts.tv_nsec > 999999999) {
+			ts.tv_nsec -= 1000000000;
+			++ts.tv_sec;
+		}
+		return ts;
+	}
+	if (++ts.tv_nsec > 999999999) {
+		ts.tv_nsec = 0;
+		++ts.tv_sec;
+	}
+	return ts;
+}
+
+/* the timestamp of a UUID, within the 36 bits of seconds */
+static struct timespec uuid7_ts_of(const uint8_t *bytes)
+{
+	struct uuid7 u;
+	uuid7_parts(&u, bytes);
+	struct timespec ts;
+	ts.tv_sec = u.seconds;
+	ts.tv_nsec = (((uint32_t)u.hifrac) << 18) | (((uint32_t)u.lofrac) << 6);
+	if (!uuid7_is_rfc9562(bytes)) {
+		ts.tv_nsec |= u.hiseq;
+	}
+	return ts;
+}
+
+/*
+   stamps ubuf with ts and a sequence of zero, in the layout of last,
+   keeping bytes 10-15
+*/
+static void uuid7_restamp(uint8_t *ubuf, struct timespec ts,
+			  const uint8_t *last)
+{
+	uint8_t next[16];
+	uuid7_pack_as(next, ts, 0, 0, uuid7_is_rfc9562(last)
+		      ? UUID7_LAYOUT_RFC9562 : UUID7_LAYOUT_SECONDS);
+	memcpy(ubuf, next, 10);
+}
+
+/*
+   Re-stamps ubuf to sort just after last_issued, keeping the segment and
+   random bytes of ubuf: the sequence of last_issued plus one, or if that
+   sequence is used up, the following tick.
+*/
+static void uuid7_borrow(uint8_t *ubuf, const uint8_t *last_issued)
+{
+	uuid7_stat_add(UUID7_STAT_BORROWED, 1);
+	uint16_t seq = uuid7_seq_of(last_issued);
+	if (seq < uuid7_seq_max(last_issued)) {
+		memcpy(ubuf, last_issued, 10);
+		uuid7_seq_set(ubuf, seq + 1);
+		return;
+	}
+	unsigned layout = uuid7_is_rfc9562(last_issued)
+	    ? UUID7_LAYOUT_RFC9562 : UUID7_LAYOUT_SECONDS;
+	struct timespec last = uuid7_ts_of(last_issued);
+	uuid7_restamp(ubuf, uuid7_next_tick(last, layout), last_issued);
+}
+
+#ifndef UUID7_NO_STATS
+/* the nanoseconds since the epoch, within the 36 bits of seconds */
+static uint64_t uuid7_ns_of(const uint8_t *bytes)
+{
+	return uuid7_ns_of_ts(uuid7_ts_of(bytes));
+}
+#endif
+
+#ifdef UUID7_ADAPTIVE_SEQ
+/* if a and b are of the same tick, ignoring the lowest bits */
+static int uuid7_same_tick(struct timespec a, struct timespec b,
+			   unsigned bits)
+{
+	return (a.tv_sec == b.tv_sec)
+	    && ((a.tv_nsec >> bits) == (b.tv_nsec >> bits));
+}
+
+/*
+   With UUID7_ADAPTIVE_SEQ, the lowest bits of the nanoseconds are below
+   the tick of the clock, thus each tick has room for (256 << bits) UUIDs.
+   If the freshly packed ubuf is of the same tick as last_issued, but not
+   after it, ubuf is stamped from last_issued: the same nanosecond, for
+   uuid7_order to add one to the sequence, or once the sequence is used
+   up, the next nanosecond. Returns 0 if the tick is used up.
+*/
+static int uuid7_extend(uint8_t *ubuf, const uint8_t *last_issued,
+			unsigned bits)
+{
+	if (memcmp(last_issued, ubuf, 9) < 0) {
+		return 1;
+	}
+	struct timespec last = uuid7_ts_of(last_issued);
+	if (!uuid7_same_tick(last, uuid7_ts_of(ubuf), bits)) {
+		return 1;
+	}
+	if (last_issued[9] < 0xFF) {
+		memcpy(ubuf, last_issued, 9);
+		return 1;
+	}
+	struct timespec next = uuid7_next_tick(last, UUID7_LAYOUT_SECONDS);
+	if (!uuid7_same_tick(last, next, bits)) {
+		return 0;
+	}
+	uuid7_stat_add(UUID7_STAT_SEQ_OVERFLOWS, 1);
+	uuid7_restamp(ubuf, next, last_issued);
+	return 1;
+}
+#endif
+
+/*
+   Compares the freshly packed ubuf against last_issued, and on success
+   sets the sequence in ubuf and records ubuf as the last_issued.
+   If borrow is set, rather than fail, ubuf is stamped from last_issued.
+   The lowest seq_bits of the nanoseconds extend the sequence, except of
+   the RFC 9562 layout, which has a counter of 14 bits.
+   The caller is responsible for any locking.
+*/
+static int uuid7_order(uint8_t *ubuf, uint8_t *last_issued, int borrow,
+		       unsigned seq_bits)
+{
+#ifdef UUID7_ADAPTIVE_SEQ
+	if (seq_bits && !uuid7_is_rfc9562(ubuf)
+	    && !uuid7_extend(ubuf, last_issued, seq_bits)) {
+		uuid7_stat_add(UUID7_STAT_SEQ_EXHAUSTED, 1);
+		if (!borrow) {
+			return 0;
+		}
+		uuid7_borrow(ubuf, last_issued);
+	}
+#else
+	(void)seq_bits;
+#endif
+
+	/* the first 9 bytes contain the seconds and the fraction */
+	static_assert((9 * 8) == (36 + 12 + 4 + 12 + 2 + 6));
+	/* or the first 8, the milliseconds and the fraction of RFC 9562 */
+	static_assert((8 * 8) == (48 + 4 + 12));
+	int cmp = memcmp(last_issued, ubuf, uuid7_prefix_len(ubuf));
+	if (cmp > 0) {
+		/*
+		   Sadly, we've gone backwards in time.
+		   The caller will have to try again when time catches up
+
+		   If they are very chummy with the library,
+		   they can declare, and call a non-API "friend" function:
+		   void uuid7_reset(void);
+		   and then call that before re-trying.
+
+		   Or, they may have asked to borrow from last_issued.
+		 */
+		uuid7_stat_add(UUID7_STAT_BACKWARDS, 1);
+		uuid7_stat_max(UUID7_STAT_MAX_BACKWARDS_NS,
+			       uuid7_ns_of(last_issued) - uuid7_ns_of(ubuf));
+		if (!borrow) {
+			return 0;
+		}
+		uuid7_borrow(ubuf, last_issued);
+	}
+	if (cmp == 0) {
+		uint32_t seq = 1 + (uint32_t)uuid7_seq_of(last_issued);
+		uint16_t max = uuid7_seq_max(ubuf);
+		if (seq <= max) {
+			uuid7_seq_set(ubuf, (uint16_t)seq);
+		} else {
+			uuid7_seq_set(ubuf, max);
+			uuid7_stat_add(UUID7_STAT_SEQ_OVERFLOWS, 1);
+			/*
+			   A 10 Ghz CPU is 10 cycles per nanosecond.
+			   Even with multiple instructions per cycle,
+			   more than 16383 in the same 64 nanoseconds
+			   suggests something is wrong with the clockid
+
+			   Perhaps the caller will be lucky and the
+			   random bits will sort naturally, we shall see
+			 */
+			if (memcmp(last_issued, ubuf, 16) >= 0) {
+				/* the caller was NOT lucky, this is a fail */
+				uuid7_stat_add(UUID7_STAT_SEQ_EXHAUSTED, 1);
+				if (!borrow) {
+					return 0;
+				}
+				uuid7_borrow(ubuf, last_issued);
+			}
+		}
+	}
+
+	void *dest = memcpy(last_issued, ubuf, 16);
+	assert(dest);
+	(void)dest;
+
+	uuid7_stat_max(UUID7_STAT_MAX_SEQ, uuid7_seq_of(ubuf));
+	return 1;
+}
+
+uint8_t *uuid7_next(uint8_t *ubuf, struct timespec ts, uint16_t segment,
+		    uint32_t random_bytes, uint8_t *last_issued)
+{
+	uuid7_pack(ubuf, ts, segment, random_bytes);
+
+#ifdef UUID7_WITH_MUTEX
+	if (uuid7_locked.initd) {
+		mtx_lock(&uuid7_locked.mutex);
+	}
+#endif
+
+	int success = uuid7_order(ubuf, last_issued, UUID7_BORROW,
+				  uuid7_seq_bits());
+
+#ifdef UUID7_WITH_MUTEX
+	if (uuid7_locked.initd) {
+		mtx_unlock(&uuid7_locked.mutex);
+	}
+#endif
+
+	if (!success) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+
+	return ubuf;
+}
+
+#ifdef UUID7_WITH_ATOMIC
+static uint64_t uuid7_key(struct timespec ts)
+{
+	return (((uint64_t)ts.tv_sec) << UUID7_KEY_SEC_SHIFT)
+	    | (((uint64_t)ts.tv_nsec) << UUID7_KEY_SEQ_BITS);
+}
+
+/* recovers the full timestamp of a key reserved at or after "now" */
+static struct timespec uuid7_key_ts(uint64_t key, struct timespec now)
+{
+	uint64_t key_sec = (key >> UUID7_KEY_SEC_SHIFT);
+	uint64_t now_sec = (uint64_t)now.tv_sec;
+	uint64_t ahead = (key_sec - now_sec) & UUID7_KEY_SEC_MASK;
+	struct timespec ts;
+	ts.tv_sec = now.tv_sec + ahead;
+	ts.tv_nsec = (key >> UUID7_KEY_SEQ_BITS) & 0x3FFFFFFF;
+	return ts;
+}
+
+/*
+   adds n to the sequence, carrying in to the nanoseconds, and
+   the nanoseconds in to the seconds
+*/
+static uint64_t uuid7_key_add(uint64_t key, uint64_t n)
+{
+	uint64_t seq = (key & 0xFF) + n;
+	uint64_t nsec = ((key >> UUID7_KEY_SEQ_BITS) & 0x3FFFFFFF) + (seq >> 8);
+	uint64_t sec = (key >> UUID7_KEY_SEC_SHIFT) + (nsec / 1000000000);
+	nsec = nsec % 1000000000;
+	return (sec << UUID7_KEY_SEC_SHIFT)
+	    | (nsec << UUID7_KEY_SEQ_BITS)
+	    | (seq & 0xFF);
+}
+
+/*
+   Reserves count consecutive keys with a single compare-and-swap,
+   returns 0 and sets *first on success, or returns -1 if the clock
+   has gone backwards relative to the last issued key.
+
+   Much like uuid7_n, if the sequence of the current tick is used up,
+   the reservation continues in to the following nanoseconds.
+*/
+#ifndef UUID7_NO_STATS
+/* counts the clock as behind the timestamp of the last issued key */
+static void uuid7_key_behind(uint64_t old, struct timespec ts)
+{
+	struct timespec then = uuid7_key_ts(old, ts);
+	int64_t behind = ((int64_t)(then.tv_sec - ts.tv_sec)) * 1000000000
+	    + (then.tv_nsec - ts.tv_nsec);
+	uuid7_stat_add(UUID7_STAT_BACKWARDS, 1);
+	uuid7_stat_max(UUID7_STAT_MAX_BACKWARDS_NS, (uint64_t)behind);
+}
+#else
+#define uuid7_key_behind(old, ts) ((void)0)
+#endif
+
+static int uuid7_reserve(struct timespec ts, size_t count, uint64_t *first)
+{
+	assert(count);
+	uint64_t now = uuid7_key(ts);
+	uint64_t old = atomic_load_explicit(&uuid7_last_key.key,
+					    memory_order_relaxed);
+	uint64_t last = 0;
+	int64_t diff = 0;
+	int same = 0;
+	unsigned tick_shift = UUID7_KEY_SEQ_BITS + uuid7_seq_bits();
+	do {
+		diff = (int64_t)(now - (old & ~((uint64_t)0xFF)));
+		same = (diff == 0) || !((now ^ old) >> tick_shift);
+		if (!old || diff > 0) {
+			*first = now;
+		} else if (same || UUID7_BORROW) {
+			/* the same tick, or borrowing from a later one */
+			*first = uuid7_key_add(old, 1);
+		} else {
+			/* the clock has gone backwards, try again later */
+			uuid7_key_behind(old, ts);
+			return -1;
+		}
+		last = uuid7_key_add(*first, count - 1);
+	} while (!atomic_compare_exchange_weak_explicit(&uuid7_last_key.key,
+							&old, last,
+							memory_order_relaxed,
+							memory_order_relaxed));
+
+	int carried = (*first != now && (old & 0xFF) == 0xFF)
+	    || (((*first & 0xFF) + (count - 1)) > 0xFF);
+	if (old && diff < 0 && !same) {
+		uuid7_key_behind(old, ts);
+		uuid7_stat_add(UUID7_STAT_BORROWED, 1);
+	}
+	if (carried) {
+		uuid7_stat_add(UUID7_STAT_SEQ_OVERFLOWS, 1);
+	}
+	uuid7_stat_max(UUID7_STAT_MAX_SEQ, carried ? 0xFF : (last & 0xFF));
+	return 0;
+}
+
+static uint8_t *uuid7_next_atomic(uint8_t *ubuf, struct timespec ts,
+				  uint16_t segment, uint32_t random_bytes)
+{
+	uint64_t key = 0;
+	if (uuid7_reserve(ts, 1, &key)) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+	uuid7_pack(ubuf, uuid7_key_ts(key, ts), segment, random_bytes);
+	ubuf[9] = (key & 0xFF);
+	return ubuf;
+}
+#endif
+
+#ifdef UUID7_PER_CPU
+static struct uuid7_cpu_slot *uuid7_cpu_slot_acquire(void)
+{
+	int cpu = sched_getcpu();
+	size_t i = (cpu < 0) ? 0 : (((size_t)cpu) % UUID7_MAX_CPUS);
+	struct uuid7_cpu_slot *slot = &uuid7_cpu_slots[i];
+
+	uuid7_cpu_slot_lock(slot);
+	if (!slot->initd) {
+		/* segment by address of the slot, much like thread_local */
+		slot->segment = u16_from_u64_xor((uint64_t)(uintptr_t)slot);
+		slot->initd = true;
+	}
+	return slot;
+}
+
+static uint8_t *uuid7_next_per_cpu(uint8_t *ubuf, struct timespec ts,
+				   uint32_t random_bytes)
+{
+	struct uuid7_cpu_slot *slot = uuid7_cpu_slot_acquire();
+	uuid7_pack(ubuf, ts, uuid7_segment_fix(slot->segment), random_bytes);
+	int success = uuid7_order(ubuf, slot->last, UUID7_BORROW,
+				  uuid7_seq_bits());
+	uuid7_cpu_slot_unlock(slot);
+
+	if (!success) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+	return ubuf;
+}
+#endif
+
+/*
+   Large requests to getrandom may be filled in pieces,
+   thus keep asking until the buffer is full.
+*/
+static int uuid7_fill_random(uint8_t *buf, size_t buflen)
+{
+	size_t pos = 0;
+	while (pos < buflen) {
+		ssize_t got = uuid7_getrandom(buf + pos, buflen - pos, 0);
+		if (got <= 0 || ((size_t)got > (buflen - pos))) {
+			uuid7_stat_add(UUID7_STAT_RANDOM_FAILURES, 1);
+			return -1;
+		}
+		pos += (size_t)got;
+	}
+	return 0;
+}
+
+#ifdef UUID7_CHACHA20
+/*
+   Rather than a call to getrandom for each refill of an entropy buffer,
+   the buffer is refilled from a ChaCha20 keystream, RFC 8439, with a
+   zero nonce and counter. The first 32 bytes of each refill are not
+   handed out, but are the key of the next refill, thus the key which
+   produced the bytes still in the buffer is gone ("fast key erasure").
+   Every UUID7_CHACHA20_RESEED refills, and after a fork, the buffer is
+   refilled from getrandom instead.
+*/
+#define UUID7_CHACHA20_KEY_SIZE 32
+#define UUID7_CHACHA20_BLOCK_SIZE 64
+
+#define uuid7_rotl32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define uuid7_chacha20_qr(x, a, b, c, d) do { \
+	x[a] += x[b]; x[d] = uuid7_rotl32(x[d] ^ x[a], 16); \
+	x[c] += x[d]; x[b] = uuid7_rotl32(x[b] ^ x[c], 12); \
+	x[a] += x[b]; x[d] = uuid7_rotl32(x[d] ^ x[a], 8); \
+	x[c] += x[d]; x[b] = uuid7_rotl32(x[b] ^ x[c], 7); \
+} while (0)
+
+static uint32_t uuid7_le32(const uint8_t *bytes)
+{
+	return (((uint32_t)bytes[0]) << (0 * 8))
+	    | (((uint32_t)bytes[1]) << (1 * 8))
+	    | (((uint32_t)bytes[2]) << (2 * 8))
+	    | (((uint32_t)bytes[3]) << (3 * 8));
+}
+
+/* "expand 32-byte k", the key, the counter, and a zero nonce */
+static void uuid7_chacha20_state(uint32_t *state, const uint8_t *key,
+				 uint32_t counter)
+{
+	state[0] = 0x61707865;
+	state[1] = 0x3320646e;
+	state[2] = 0x79622d32;
+	state[3] = 0x6b206574;
+	for (size_t i = 0; i < 8; ++i) {
+		state[4 + i] = uuid7_le32(key + (4 * i));
+	}
+	state[12] = counter;
+	state[13] = 0;
+	state[14] = 0;
+	state[15] = 0;
+}
+
+static void uuid7_chacha20_block(uint8_t *out, const uint32_t *state)
+{
+	uint32_t x[16];
+	memcpy(x, state, sizeof(x));
+	for (size_t i = 0; i < 10; ++i) {
+		uuid7_chacha20_qr(x, 0, 4, 8, 12);
+		uuid7_chacha20_qr(x, 1, 5, 9, 13);
+		uuid7_chacha20_qr(x, 2, 6, 10, 14);
+		uuid7_chacha20_qr(x, 3, 7, 11, 15);
+		uuid7_chacha20_qr(x, 0, 5, 10, 15);
+		uuid7_chacha20_qr(x, 1, 6, 11, 12);
+		uuid7_chacha20_qr(x, 2, 7, 8, 13);
+		uuid7_chacha20_qr(x, 3, 4, 9, 14);
+	}
+	for (size_t i = 0; i < 16; ++i) {
+		uint32_t word = x[i] + state[i];
+		out[(4 * i) + 0] = (word >> (0 * 8)) & 0xFF;
+		out[(4 * i) + 1] = (word >> (1 * 8)) & 0xFF;
+		out[(4 * i) + 2] = (word >> (2 * 8)) & 0xFF;
+		out[(4 * i) + 3] = (word >> (3 * 8)) & 0xFF;
+	}
+}
+
+/*
+   Four blocks at a time: each vector holds the same word of the four
+   blocks, thus the quarter rounds are the same as for one block.
+*/
+#if !defined(UUID7_NO_SIMD) && defined(__SSE2__)
+#define UUID7_CHACHA20_SSE2 1
+#include <emmintrin.h>
+#elif !defined(UUID7_NO_SIMD) && defined(__aarch64__) \
+	&& defined(__ARM_NEON) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define UUID7_CHACHA20_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* for UUID7_DEBUG, allow forcing the one block at a time at runtime */
+#ifdef UUID7_DEBUG
+int uuid7_chacha20_simd = 1;
+#else
+#define uuid7_chacha20_simd 1
+#endif
+
+#if defined(UUID7_CHACHA20_SSE2) || defined(UUID7_CHACHA20_NEON)
+#ifdef UUID7_CHACHA20_SSE2
+typedef __m128i uuid7_u32x4;
+#define uuid7_x4_add(a, b) _mm_add_epi32(a, b)
+#define uuid7_x4_xor(a, b) _mm_xor_si128(a, b)
+#define uuid7_x4_rotl(v, n) \
+	_mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define uuid7_x4_set1(u32) _mm_set1_epi32((int)(u32))
+#else
+typedef uint32x4_t uuid7_u32x4;
+#define uuid7_x4_add(a, b) vaddq_u32(a, b)
+#define uuid7_x4_xor(a, b) veorq_u32(a, b)
+#define uuid7_x4_rotl(v, n) \
+	vorrq_u32(vshlq_n_u32(v, n), vshrq_n_u32(v, 32 - (n)))
+#define uuid7_x4_set1(u32) vdupq_n_u32(u32)
+#endif
+
+#define uuid7_chacha20_qr4(x, a, b, c, d) do { \
+	x[a] = uuid7_x4_add(x[a], x[b]); \
+	x[d] = uuid7_x4_rotl(uuid7_x4_xor(x[d], x[a]), 16); \
+	x[c] = uuid7_x4_add(x[c], x[d]); \
+	x[b] = uuid7_x4_rotl(uuid7_x4_xor(x[b], x[c]), 12); \
+	x[a] = uuid7_x4_add(x[a], x[b]); \
+	x[d] = uuid7_x4_rotl(uuid7_x4_xor(x[d], x[a]), 8); \
+	x[c] = uuid7_x4_add(x[c], x[d]); \
+	x[b] = uuid7_x4_rotl(uuid7_x4_xor(x[b], x[c]), 7); \
+} while (0)
+
+/* writes the blocks of counters state[12] through state[12] + 3 */
+static void uuid7_chacha20_block4(uint8_t *out, const uint32_t *state)
+{
+	uuid7_u32x4 in[16];
+	uuid7_u32x4 x[16];
+	for (size_t i = 0; i < 16; ++i) {
+		in[i] = uuid7_x4_set1(state[i]);
+	}
+#ifdef UUID7_CHACHA20_SSE2
+	in[12] = _mm_add_epi32(in[12], _mm_set_epi32(3, 2, 1, 0));
+#else
+	static const uint32_t lanes[4] = { 0, 1, 2, 3 };
+	in[12] = vaddq_u32(in[12], vld1q_u32(lanes));
+#endif
+	memcpy(x, in, sizeof(x));
+	for (size_t i = 0; i < 10; ++i) {
+		uuid7_chacha20_qr4(x, 0, 4, 8, 12);
+		uuid7_chacha20_qr4(x, 1, 5, 9, 13);
+		uuid7_chacha20_qr4(x, 2, 6, 10, 14);
+		uuid7_chacha20_qr4(x, 3, 7, 11, 15);
+		uuid7_chacha20_qr4(x, 0, 5, 10, 15);
+		uuid7_chacha20_qr4(x, 1, 6, 11, 12);
+		uuid7_chacha20_qr4(x, 2, 7, 8, 13);
+		uuid7_chacha20_qr4(x, 3, 4, 9, 14);
+	}
+	for (size_t i = 0; i < 16; ++i) {
+		x[i] = uuid7_x4_add(x[i], in[i]);
+	}
+
+	/* transpose each 4 words of the 4 blocks, little-endian */
+	for (size_t i = 0; i < 16; i += 4) {
+#ifdef UUID7_CHACHA20_SSE2
+		__m128i ab_lo = _mm_unpacklo_epi32(x[i + 0], x[i + 1]);
+		__m128i cd_lo = _mm_unpacklo_epi32(x[i + 2], x[i + 3]);
+		__m128i ab_hi = _mm_unpackhi_epi32(x[i + 0], x[i + 1]);
+		__m128i cd_hi = _mm_unpackhi_epi32(x[i + 2], x[i + 3]);
+		__m128i words[4];
+		words[0] = _mm_unpacklo_epi64(ab_lo, cd_lo);
+		words[1] = _mm_unpackhi_epi64(ab_lo, cd_lo);
+		words[2] = _mm_unpacklo_epi64(ab_hi, cd_hi);
+		words[3] = _mm_unpackhi_epi64(ab_hi, cd_hi);
+		for (size_t j = 0; j < 4; ++j) {
+			uint8_t *dst = out + (j * UUID7_CHACHA20_BLOCK_SIZE);
+			_mm_storeu_si128((__m128i *)(dst + (4 * i)), words[j]);
+		}
+#else
+		uint32x4x4_t quad = { {
+				x[i + 0], x[i + 1], x[i + 2], x[i + 3]
+			}
+		};
+		uint32_t words[16];
+		vst4q_u32(words, quad);
+		for (size_t j = 0; j < 4; ++j) {
+			uint8_t *dst = out + (j * UUID7_CHACHA20_BLOCK_SIZE);
+			memcpy(dst + (4 * i), words + (4 * j), 16);
+		}
+#endif
+	}
+}
+#endif
+
+/*
+   A friend function: fills out with len bytes of the keystream of key,
+   key may be within out, as it is read before anything is written.
+*/
+void uuid7_chacha20(uint8_t *out, size_t len, const uint8_t *key)
+{
+	uint32_t state[16];
+	uuid7_chacha20_state(state, key, 0);
+
+#if defined(UUID7_CHACHA20_SSE2) || defined(UUID7_CHACHA20_NEON)
+	const size_t four = 4 * UUID7_CHACHA20_BLOCK_SIZE;
+	while (uuid7_chacha20_simd && (len >= four)) {
+		uuid7_chacha20_block4(out, state);
+		state[12] += 4;
+		out += four;
+		len -= four;
+	}
+#endif
+	uint8_t block[UUID7_CHACHA20_BLOCK_SIZE];
+	while (len) {
+		size_t size = uuid7_minz(len, sizeof(block));
+		uuid7_chacha20_block(block, state);
+		memcpy(out, block, size);
+		++state[12];
+		out += size;
+		len -= size;
+	}
+	/* do not leave the key lying around */
+	memset(state, 0x00, sizeof(state));
+	memset(block, 0x00, sizeof(block));
+}
+#endif
+
+/* refills the whole of the buffer, with UUID7_CHACHA20 from the key */
+static int uuid7_entropy_refill(struct uuid7_entropy_buf *entropy)
+{
+#ifdef UUID7_CHACHA20
+	if (entropy->size >= UUID7_CHACHA20_BLOCK_SIZE) {
+		if (entropy->refills) {
+			uuid7_chacha20(entropy->bytes, entropy->size,
+				       entropy->bytes);
+		} else if (uuid7_fill_random(entropy->bytes, entropy->size)) {
+			return -1;
+		}
+		entropy->refills = ((entropy->refills + 1)
+				    % UUID7_CHACHA20_RESEED);
+		/* the key of the next refill is not to be handed out */
+		entropy->pos = UUID7_CHACHA20_KEY_SIZE;
+		return 0;
+	}
+#endif
+	return uuid7_fill_random(entropy->bytes, entropy->size);
+}
+
+/*
+   Registered as the pthread_atfork child handler, and may also be called
+   directly in a child created some other way, e.g. a raw clone(2).
+*/
+void uuid7_forked(void)
+{
+	++uuid7_fork_generation;
+}
+
+#ifndef ARDUINO
+static void uuid7_atfork_register(void)
+{
+	uuid7_atfork_rv = pthread_atfork(NULL, NULL, uuid7_forked);
+}
+#endif
+
+/* returns 0 once a forked child will know to discard buffered bytes */
+static int uuid7_atfork_init(void)
+{
+#ifdef ARDUINO
+	return 0;
+#else
+#if (UUID7_NO_THREADS)
+	if (uuid7_atfork_rv) {
+		uuid7_atfork_register();
+	}
+#else
+	call_once(&uuid7_atfork_once, uuid7_atfork_register);
+#endif
+	return uuid7_atfork_rv;
+#endif
+}
+
+#ifdef UUID7_FAST_RANDOM
+static uint64_t uuid7_rotl64(uint64_t v, unsigned n)
+{
+	return (v << n) | (v >> (64 - n));
+}
+
+/* https://prng.di.unimi.it/xoshiro256starstar.c */
+static uint64_t uuid7_xoshiro_next(struct uuid7_xoshiro *x)
+{
+	uint64_t *s = x->s;
+	const uint64_t result = uuid7_rotl64(s[1] * 5, 7) * 9;
+	const uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = uuid7_rotl64(s[3], 45);
+
+	return result;
+}
+
+static ssize_t uuid7_xoshiro_getrandom(void *buf, size_t buflen,
+				       unsigned int flags)
+{
+	struct uuid7_xoshiro *x = &uuid7_xoshiro;
+	if (!x->seeded || x->fork_generation != uuid7_fork_generation) {
+		ssize_t got = getrandom(x->s, sizeof(x->s), flags);
+		if (uuid7_atfork_init() || got != (ssize_t)sizeof(x->s)) {
+			return -1;
+		}
+		/* the one state which must be avoided is all zeros */
+		x->s[0] |= !(x->s[0] | x->s[1] | x->s[2] | x->s[3]);
+		x->fork_generation = uuid7_fork_generation;
+		x->seeded = true;
+	}
+	uint8_t *bytes = (uint8_t *)buf;
+	for (size_t pos = 0; pos < buflen; pos += sizeof(uint64_t)) {
+		uint64_t next = uuid7_xoshiro_next(x);
+		size_t size = uuid7_minz(sizeof(next), buflen - pos);
+		memcpy(bytes + pos, &next, size);
+	}
+	return (ssize_t)buflen;
+}
+#endif
+
+static int uuid7_entropy_take(struct uuid7_entropy_buf *entropy, void *buf,
+			      size_t len)
+{
+	assert(len <= entropy->size);
+
+	if (entropy->fork_generation != uuid7_fork_generation) {
+		uuid7_entropy_clear(entropy);
+	}
+
+	if (len > (entropy->len - entropy->pos)) {
+		entropy->pos = 0;
+		entropy->len = 0;
+		if (uuid7_atfork_init() || uuid7_entropy_refill(entropy)) {
+			return -1;
+		}
+		entropy->len = entropy->size;
+	}
+
+	uint8_t *pos = entropy->bytes + entropy->pos;
+	memcpy(buf, pos, len);
+	/* do not leave handed out bytes lying around */
+	memset(pos, 0x00, len);
+	entropy->pos += len;
+
+	return 0;
+}
+
+static int uuid7_getrandom_exact(void *buf, size_t len)
+{
+	ssize_t rndbytes = uuid7_getrandom(buf, len, 0);
+	if (rndbytes < 0 || ((size_t)rndbytes != len)) {
+		uuid7_stat_add(UUID7_STAT_RANDOM_FAILURES, 1);
+		return -1;
+	}
+	return 0;
+}
+
+static int uuid7_random(void *buf, size_t len)
+{
+#ifdef UUID7_ENTROPY_POOL
+	if (!uuid7_pool.bytes) {
+		uuid7_pool.bytes = uuid7_pool_bytes;
+		uuid7_pool.size = sizeof(uuid7_pool_bytes);
+	}
+	return uuid7_entropy_take(&uuid7_pool, buf, len);
+#else
+	return uuid7_getrandom_exact(buf, len);
+#endif
+}
+
+static uint16_t uuid7_segment(uint16_t random16)
+{
+#ifdef UUID7_WITH_MUTEX
+	/* everything is mutexed, there is no segmenting */
+	return uuid7_segment_fix(random16);
+#elif defined(UUID7_WITH_ATOMIC)
+	/* there is one global stream, there is no segmenting */
+	return uuid7_segment_fix(random16);
+#elif defined(UUID7_PER_CPU)
+	/* unused, the segment belongs to the CPU slot */
+	return uuid7_segment_fix(random16);
+#elif UUID7_NO_THREADS
+	/* there is only one thread, there is no segmenting */
+	return uuid7_segment_fix(random16);
+#else
+	/* segment by address of thread_local */
+	(void)random16;
+	return uuid7_segment_fix(u16_from_u64_xor((uint64_t) uuid7_last));
+#endif
+}
+
+static uint8_t *uuid7_one(uint8_t *ubuf)
+{
+	struct timespec ts;
+	if (uuid7_now(&ts)) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+
+	uint64_t random_bytes = 0;
+	if (uuid7_random(&random_bytes, sizeof(random_bytes))) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+
+	uint32_t rand32 = (0xFFFFFFFF & random_bytes);
+#ifdef UUID7_PER_CPU
+	return uuid7_next_per_cpu(ubuf, ts, rand32);
+#else
+	uint16_t segment = uuid7_segment((uint16_t)(random_bytes >> (4 * 8)));
+#ifdef UUID7_WITH_ATOMIC
+	return uuid7_next_atomic(ubuf, ts, segment, rand32);
+#else
+#ifdef UUID7_LAST_THREAD_LOCAL
+	uuid7_last_epoch_check();
+#endif
+	return uuid7_next(ubuf, ts, segment, rand32, uuid7_last);
+#endif
+#endif
+}
+
+uint8_t *uuid7(uint8_t *ubuf)
+{
+	return uuid7_stats_done(uuid7_one(ubuf), 1);
+}
+
+/*
+   Packs and orders count UUIDs in out against last_issued, with the
+   random bytes already in place in bytes 10-15 of each UUID. If segment
+   is NULL, the segment of each UUID comes from uuid7_segment.
+
+   Whenever 256 UUIDs have been issued for the same 72 bit prefix, the
+   timestamp is advanced by a nanosecond.
+
+   The caller is responsible for any locking.
+*/
+static int uuid7_order_n(uint8_t *out, size_t count, struct timespec ts,
+			 uint8_t *last_issued, const uint16_t *segment,
+			 int borrow, unsigned seq_bits, unsigned layout)
+{
+	int success = 1;
+	for (size_t i = 0; success && i < count; ++i) {
+		uint8_t *ubuf = out + (i * 16);
+		uint16_t seg = segment ? *segment
+		    : uuid7_segment((((uint16_t)ubuf[10]) << 8) | ubuf[11]);
+		uint32_t random_bytes = (((uint32_t)ubuf[15]) << (3 * 8))
+		    | (((uint32_t)ubuf[14]) << (2 * 8))
+		    | (((uint32_t)ubuf[13]) << (1 * 8))
+		    | (((uint32_t)ubuf[12]) << (0 * 8));
+
+		uuid7_pack_as(ubuf, ts, seg, random_bytes, layout);
+		if ((uuid7_seq_of(last_issued) == uuid7_seq_max(ubuf))
+		    && !memcmp(last_issued, ubuf, uuid7_prefix_len(ubuf))) {
+			/* the sequence is saturated, move to the next tick */
+			uuid7_stat_add(UUID7_STAT_SEQ_OVERFLOWS, 1);
+			ts = uuid7_next_tick(ts, layout);
+			uuid7_pack_as(ubuf, ts, seg, random_bytes, layout);
+		}
+		success = uuid7_order(ubuf, last_issued, borrow, seq_bits);
+	}
+	return success;
+}
+
+#ifdef UUID7_WITH_ATOMIC
+/* as uuid7_order_n, but the whole batch is reserved at once */
+static int uuid7_reserve_n(uint8_t *out, size_t count, struct timespec ts)
+{
+	uint64_t key = 0;
+	if (count && uuid7_reserve(ts, count, &key)) {
+		return 0;
+	}
+	ts = uuid7_key_ts(key, ts);
+	uint8_t seq = (key & 0xFF);
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t *ubuf = out + (i * 16);
+		uint16_t segment =
+		    uuid7_segment((((uint16_t)ubuf[10]) << 8) | ubuf[11]);
+		uint32_t random_bytes = (((uint32_t)ubuf[15]) << (3 * 8))
+		    | (((uint32_t)ubuf[14]) << (2 * 8))
+		    | (((uint32_t)ubuf[13]) << (1 * 8))
+		    | (((uint32_t)ubuf[12]) << (0 * 8));
+
+		uuid7_pack(ubuf, ts, segment, random_bytes);
+		ubuf[9] = seq;
+		if (seq++ == 0xFF) {
+			ts = uuid7_next_tick(ts, UUID7_LAYOUT_SECONDS);
+		}
+	}
+	return 1;
+}
+#endif
+
+#ifdef UUID7_PER_CPU
+/* as uuid7_order_n, holding the slot of the current CPU */
+static int uuid7_per_cpu_n(uint8_t *out, size_t count, struct timespec ts)
+{
+	struct uuid7_cpu_slot *slot = uuid7_cpu_slot_acquire();
+	uint16_t segment = uuid7_segment_fix(slot->segment);
+	int success = uuid7_order_n(out, count, ts, slot->last, &segment,
+				    UUID7_BORROW, uuid7_seq_bits(),
+				    UUID7_LAYOUT_SECONDS);
+	uuid7_cpu_slot_unlock(slot);
+	return success;
+}
+#endif
+
+/*
+   Fills out with count UUIDs, 16 bytes each, with only one call to
+   clock_gettime and one request for random bytes for the whole batch.
+
+   The random bytes are read directly in to the output buffer, and the
+   bytes 10-15 of each UUID are used for the segment and random bits.
+
+   Whenever 256 UUIDs have been issued for the same 72 bit prefix, the
+   timestamp is advanced by a nanosecond, thus the last UUIDs of a large
+   batch may be stamped up to (count / 256) nanoseconds after the clock
+   was read. The UUIDs are strictly ordered with respect to uuid7_last,
+   and all UUIDs issued by uuid7() or uuid7_n() after the batch will
+   sort after the UUIDs of the batch.
+
+   With UUID7_WITH_ATOMIC, the whole batch is reserved with a single
+   compare-and-swap.
+
+   On failure, the whole buffer is zeroed and NULL is returned.
+*/
+static uint8_t *uuid7_batch(uint8_t *out, size_t count)
+{
+	assert(out || !count);
+	if (count > (SIZE_MAX / 16)) {
+		return NULL;
+	}
+
+	int success = 0;
+	size_t size = count * 16;
+	struct timespec ts;
+	if (uuid7_now(&ts)) {
+		goto uuid7_n_end;
+	}
+	if (uuid7_fill_random(out, size)) {
+		goto uuid7_n_end;
+	}
+#ifdef UUID7_WITH_ATOMIC
+	success = uuid7_reserve_n(out, count, ts);
+#elif defined(UUID7_PER_CPU)
+	success = uuid7_per_cpu_n(out, count, ts);
+#else
+
+#ifdef UUID7_WITH_MUTEX
+	if (uuid7_locked.initd) {
+		mtx_lock(&uuid7_locked.mutex);
+	}
+#endif
+#ifdef UUID7_LAST_THREAD_LOCAL
+	uuid7_last_epoch_check();
+#endif
+
+	success = uuid7_order_n(out, count, ts, uuid7_last, NULL,
+				UUID7_BORROW, uuid7_seq_bits(),
+				UUID7_LAYOUT_SECONDS);
+
+#ifdef UUID7_WITH_MUTEX
+	if (uuid7_locked.initd) {
+		mtx_unlock(&uuid7_locked.mutex);
+	}
+#endif
+
+#endif
+uuid7_n_end:
+	if (!success) {
+		memset(out, 0x00, size);
+		return NULL;
+	}
+	return out;
+}
+
+uint8_t *uuid7_n(uint8_t *out, size_t count)
+{
+	return uuid7_stats_done(uuid7_batch(out, count), count);
+}
+
+void uuid7_gen_init(struct uuid7_gen *gen, uint8_t *entropy,
+		    size_t entropy_size)
+{
+	assert(gen);
+	memset(gen, 0x00, sizeof(struct uuid7_gen));
+
+	/* segment by address of the generator, much like thread_local */
+	gen->segment =
+	    uuid7_segment_fix(u16_from_u64_xor((uint64_t)(uintptr_t)gen));
+	gen->clockid = uuid7_clockid;
+	gen->seq_bits = uuid7_seq_bits();
+	gen->epoch = uuid7_epoch_now();
+
+	/* a buffer too small to hold even one draw is not useful */
+	if (entropy && (entropy_size >= sizeof(uint32_t))) {
+		gen->entropy.bytes = entropy;
+		gen->entropy.size = entropy_size;
+	}
+	uuid7_entropy_clear(&gen->entropy);
+}
+
+void uuid7_gen_policy(struct uuid7_gen *gen, unsigned policy)
+{
+	assert(gen);
+	assert(policy == UUID7_POLICY_FAIL || policy == UUID7_POLICY_BORROW);
+	gen->policy = (uint8_t)policy;
+}
+
+void uuid7_gen_layout(struct uuid7_gen *gen, unsigned layout)
+{
+	assert(gen);
+	assert(layout == UUID7_LAYOUT_SECONDS
+	       || layout == UUID7_LAYOUT_RFC9562);
+	gen->layout = (uint8_t)layout;
+	/* the layouts do not sort with each other */
+	uuid7_gen_reset(gen);
+}
+
+void uuid7_gen_segment(struct uuid7_gen *gen, uint16_t segment)
+{
+	assert(gen);
+	gen->segment = segment;
+}
+
+void uuid7_gen_reset(struct uuid7_gen *gen)
+{
+	assert(gen);
+	memset(gen->last, 0x00, 16);
+	gen->epoch = uuid7_epoch_now();
+}
+
+int uuid7_gen_clock(struct uuid7_gen *gen, clockid_t clockid)
+{
+	assert(gen);
+#ifdef UUID7_ADAPTIVE_SEQ
+	struct uuid7_clock_info info;
+	if (uuid7_clock_probe(clockid, &info)) {
+		return -1;
+	}
+	gen->seq_bits = (uint8_t)uuid7_seq_bits_of(&info);
+#else
+	struct timespec ts;
+	if (uuid7_clock_gettime(clockid, &ts)) {
+		return -1;
+	}
+#endif
+	gen->clockid = clockid;
+	return 0;
+}
+
+static int uuid7_gen_now(struct uuid7_gen *gen, struct timespec *ts)
+{
+	/* with UUID7_TSC, the TSC is anchored to uuid7_clockid */
+	if (gen->clockid == uuid7_clockid) {
+		return uuid7_now(ts);
+	}
+	return uuid7_clock_now(gen->clockid, ts);
+}
+
+static int uuid7_gen_random(struct uuid7_gen *gen, void *buf, size_t len)
+{
+	if (gen->entropy.bytes) {
+		return uuid7_entropy_take(&gen->entropy, buf, len);
+	}
+	return uuid7_getrandom_exact(buf, len);
+}
+
+static uint8_t *uuid7_gen_one(struct uuid7_gen *gen, uint8_t *ubuf)
+{
+	assert(gen);
+	assert(ubuf);
+
+	struct timespec ts;
+	uint32_t random_bytes = 0;
+	if (uuid7_gen_now(gen, &ts)
+	    || uuid7_gen_random(gen, &random_bytes, sizeof(random_bytes))) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+
+	uuid7_gen_epoch_check(gen);
+	uuid7_pack_as(ubuf, ts, gen->segment, random_bytes, gen->layout);
+	if (!uuid7_order(ubuf, gen->last, gen->policy == UUID7_POLICY_BORROW,
+			 gen->seq_bits)) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+	return ubuf;
+}
+
+uint8_t *uuid7_gen_next(struct uuid7_gen *gen, uint8_t *ubuf)
+{
+	return uuid7_stats_done(uuid7_gen_one(gen, ubuf), 1);
+}
+
+static uint8_t *uuid7_gen_batch(struct uuid7_gen *gen, uint8_t *out,
+				 size_t count)
+{
+	assert(gen);
+	assert(out || !count);
+	if (count > (SIZE_MAX / 16)) {
+		return NULL;
+	}
+
+	size_t size = count * 16;
+	struct timespec ts;
+	uuid7_gen_epoch_check(gen);
+	if (uuid7_gen_now(gen, &ts)
+	    || uuid7_fill_random(out, size)
+	    || !uuid7_order_n(out, count, ts, gen->last, &gen->segment,
+			      gen->policy == UUID7_POLICY_BORROW,
+			      gen->seq_bits, gen->layout)) {
+		memset(out, 0x00, size);
+		return NULL;
+	}
+	return out;
+}
+
+uint8_t *uuid7_gen_n(struct uuid7_gen *gen, uint8_t *out, size_t count)
+{
+	return uuid7_stats_done(uuid7_gen_batch(gen, out, count), count);
+}
+
+#if !(UUID7_NO_THREADS)
+/*
+   A ring of pre-minted UUIDs, filled by a producer thread with its own
+   generator, using uuid7_gen_n. The head and tail only ever increase,
+   the slot of an index is (index & mask). A consumer takes the UUID at
+   the head, then claims it with a compare-and-swap of the head, thus
+   any number of threads may take. The producer only writes the slots
+   between the tail and the head plus the capacity, those already taken.
+
+   The producer sleeps until the count falls to the low-water mark, or
+   until half of max_age_ns has passed, when it discards the UUIDs which
+   are older than max_age_ns.
+*/
+#include <stdatomic.h>
+#include <stdbool.h>
+
+struct uuid7_ring {
+	/* written by the consumers, and by the producer, each its own line */
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) _Atomic size_t head;
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) _Atomic size_t tail;
+	/* read-mostly */
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) size_t mask;
+	size_t low_water;
+	uint64_t max_age_ns;
+	uint8_t *slots;
+	_Atomic bool waiting;
+	_Atomic bool stop;
+	struct uuid7_gen gen;
+	mtx_t mutex;
+	cnd_t wake;
+	thrd_t producer;
+};
+
+static size_t uuid7_ring_count(struct uuid7_ring *ring)
+{
+	size_t head = atomic_load(&ring->head);
+	size_t tail = atomic_load(&ring->tail);
+	return tail - head;
+}
+
+/* fills the taken slots, in at most two runs due to the wrap */
+static int uuid7_ring_fill(struct uuid7_ring *ring)
+{
+	size_t capacity = ring->mask + 1;
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	size_t room = capacity - uuid7_ring_count(ring);
+	while (room) {
+		size_t at = tail & ring->mask;
+		size_t run = (capacity - at) < room ? (capacity - at) : room;
+		if (!uuid7_gen_n(&ring->gen, ring->slots + (at * 16), run)) {
+			/* the clock or random bytes failed, try again later */
+			return -1;
+		}
+		tail += run;
+		room -= run;
+		atomic_store_explicit(&ring->tail, tail, memory_order_release);
+	}
+	return 0;
+}
+
+/* discards, from the head, UUIDs stamped more than max_age_ns ago */
+static void uuid7_ring_expire(struct uuid7_ring *ring)
+{
+	struct timespec ts;
+	if (uuid7_clock_now(ring->gen.clockid, &ts)) {
+		return;
+	}
+	uint64_t now = uuid7_ns_of_ts(ts);
+	size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	while (head != tail) {
+		uint8_t *ubuf = ring->slots + ((head & ring->mask) * 16);
+		uint64_t minted = uuid7_ns_of_ts(uuid7_ts_of(ubuf));
+		if ((minted >= now) || ((now - minted) <= ring->max_age_ns)) {
+			return;
+		}
+		/* on failure, head is reloaded: a consumer took it first */
+		atomic_compare_exchange_weak(&ring->head, &head, head + 1);
+	}
+}
+
+static int uuid7_ring_producer(void *context)
+{
+	struct uuid7_ring *ring = (struct uuid7_ring *)context;
+	mtx_lock(&ring->mutex);
+	while (!atomic_load(&ring->stop)) {
+		mtx_unlock(&ring->mutex);
+		uuid7_ring_expire(ring);
+		int failed = uuid7_ring_fill(ring);
+		mtx_lock(&ring->mutex);
+
+		struct timespec until;
+		timespec_get(&until, TIME_UTC);
+		uint64_t ns = until.tv_nsec + (ring->max_age_ns / 2);
+		until.tv_sec += ns / 1000000000;
+		until.tv_nsec = ns % 1000000000;
+
+		/* a take which sees waiting signals, once it has the mutex */
+		atomic_store(&ring->waiting, true);
+		if (!atomic_load(&ring->stop)
+		    && (failed || (uuid7_ring_count(ring) > ring->low_water))) {
+			cnd_timedwait(&ring->wake, &ring->mutex, &until);
+		}
+		atomic_store(&ring->waiting, false);
+	}
+	mtx_unlock(&ring->mutex);
+	return 0;
+}
+
+static void uuid7_ring_wake(struct uuid7_ring *ring)
+{
+	mtx_lock(&ring->mutex);
+	cnd_signal(&ring->wake);
+	mtx_unlock(&ring->mutex);
+}
+
+struct uuid7_ring *uuid7_ring_start(size_t capacity, size_t low_water,
+				    uint64_t max_age_ns)
+{
+	if (!capacity || (capacity & (capacity - 1)) || low_water >= capacity
+	    || (capacity > (SIZE_MAX / 32)) || !max_age_ns) {
+		return NULL;
+	}
+	/* the slots follow the struct, padded to a multiple of a line */
+	size_t line = UUID7_CACHE_LINE;
+	size_t size = sizeof(struct uuid7_ring) + (capacity * 16);
+	size = (size + line - 1) & ~(line - 1);
+	struct uuid7_ring *ring;
+	ring = (struct uuid7_ring *)aligned_alloc(line, size);
+	if (!ring) {
+		return NULL;
+	}
+	memset(ring, 0x00, sizeof(struct uuid7_ring));
+	ring->mask = capacity - 1;
+	ring->low_water = low_water;
+	ring->max_age_ns = max_age_ns;
+	ring->slots = (uint8_t *)(ring + 1);
+	uuid7_gen_init(&ring->gen, NULL, 0);
+	uuid7_gen_policy(&ring->gen, UUID7_POLICY_BORROW);
+	if (mtx_init(&ring->mutex, mtx_plain) == thrd_success) {
+		if (cnd_init(&ring->wake) == thrd_success) {
+			if (uuid7_thrd_create(&ring->producer,
+					      uuid7_ring_producer,
+					      ring) == thrd_success) {
+				return ring;
+			}
+			cnd_destroy(&ring->wake);
+		}
+		mtx_destroy(&ring->mutex);
+	}
+	free(ring);
+	return NULL;
+}
+
+uint8_t *uuid7_take(struct uuid7_ring *ring, uint8_t *ubuf)
+{
+	size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	size_t tail;
+	do {
+		tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+		if (head == tail) {
+			memset(ubuf, 0x00, 16);
+			if (atomic_load(&ring->waiting)) {
+				uuid7_ring_wake(ring);
+			}
+			return NULL;
+		}
+		memcpy(ubuf, ring->slots + ((head & ring->mask) * 16), 16);
+		/* on failure, head is reloaded: another take was first */
+	} while (!atomic_compare_exchange_weak(&ring->head, &head, head + 1));
+
+	if (((tail - head - 1) <= ring->low_water)
+	    && atomic_load(&ring->waiting)) {
+		uuid7_ring_wake(ring);
+	}
+	return ubuf;
+}
+
+void uuid7_ring_stop(struct uuid7_ring *ring)
+{
+	if (!ring) {
+		return;
+	}
+	mtx_lock(&ring->mutex);
+	atomic_store(&ring->stop, true);
+	cnd_signal(&ring->wake);
+	mtx_unlock(&ring->mutex);
+	thrd_join(ring->producer, NULL);
+	cnd_destroy(&ring->wake);
+	mtx_destroy(&ring->mutex);
+	free(ring);
+}
+#endif
+
+struct uuid7_columns *uuid7_parts_n(struct uuid7_columns *columns,
+				    const uint8_t *ids, size_t count)
+{
+	assert(columns);
+	assert(ids || !count);
+	int all_valid = 1;
+	for (size_t i = 0; i < count; ++i) {
+		const uint8_t *id = ids + (16 * i);
+		uint8_t variant = (id[8] & 0xC0) >> 6;
+		int valid = ((id[6] & 0xF0) == (UUID7_VERSION << 4))
+		    && ((variant == UUID7_VARIANT)
+			|| (variant == UUID7_VARIANT_RFC9562));
+		all_valid &= valid;
+		/* a mask of all ones if valid, else zero */
+		uint64_t mask = 0 - (uint64_t)valid;
+		if (columns->unix_ns) {
+			columns->unix_ns[i] = uuid7_timestamp_ns(id) & mask;
+		}
+		if (columns->segment) {
+			uint16_t segment = (((uint16_t)id[10]) << 8) | id[11];
+			columns->segment[i] = segment & mask;
+		}
+		if (columns->seq) {
+			uint16_t hiseq = (variant == UUID7_VARIANT_RFC9562)
+			    ? (id[8] & 0x3F) : 0;
+			columns->seq[i] = ((hiseq << 8) | id[9]) & mask;
+		}
+		if (columns->rand) {
+			uint32_t rand;
+			rand = (((uint32_t)id[15]) << (8 * 3))
+			    | (((uint32_t)id[14]) << (8 * 2))
+			    | (((uint32_t)id[13]) << (8 * 1))
+			    | (((uint32_t)id[12]) << (8 * 0));
+			columns->rand[i] = rand & mask;
+		}
+	}
+	return all_valid ? columns : NULL;
+}
+
+uint64_t *uuid7_hash64_n(uint64_t *out, const uint8_t *ids, size_t count)
+{
+	assert(out || !count);
+	assert(ids || !count);
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = uuid7_hash64(ids + (16 * i));
+	}
+	return out;
+}
+
+/*
+   Sorting is an LSD radix sort of the 80 bit prefix of time and
+   sequence, a byte at a time, stable, from byte 9 to byte 0. The counts
+   of all ten bytes are taken in one pass, and the pass of a byte which
+   is the same in every UUID, as are most of the bytes of the seconds,
+   is skipped. UUIDs of the same prefix, e.g. of different segments, are
+   then put in order with an insertion sort of each run of them.
+*/
+#define UUID7_SORT_PREFIX 10
+#ifndef UUID7_SORT_SMALL
+#define UUID7_SORT_SMALL 64
+#endif
+
+static void uuid7_insertion_sort(uint8_t *ids, size_t count)
+{
+	uint8_t tmp[16];
+	for (size_t i = 1; i < count; ++i) {
+		size_t j = i;
+		memcpy(tmp, ids + (16 * i), 16);
+		while (j && uuid7_compare(ids + (16 * (j - 1)), tmp) > 0) {
+			memcpy(ids + (16 * j), ids + (16 * (j - 1)), 16);
+			--j;
+		}
+		memcpy(ids + (16 * j), tmp, 16);
+	}
+}
+
+static int uuid7_sorted(const uint8_t *ids, size_t count)
+{
+	for (size_t i = 1; i < count; ++i) {
+		if (uuid7_compare(ids + (16 * (i - 1)), ids + (16 * i)) > 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void uuid7_radix_sort(uint8_t *ids, uint8_t *scratch, size_t count)
+{
+	size_t counts[UUID7_SORT_PREFIX][256];
+	memset(counts, 0x00, sizeof(counts));
+	for (size_t i = 0; i < count; ++i) {
+		const uint8_t *id = ids + (16 * i);
+		for (size_t d = 0; d < UUID7_SORT_PREFIX; ++d) {
+			++counts[d][id[d]];
+		}
+	}
+
+	uint8_t *from = ids;
+	uint8_t *to = scratch;
+	for (size_t d = UUID7_SORT_PREFIX; d--;) {
+		if (counts[d][from[d]] == count) {
+			continue;
+		}
+		size_t offsets[256];
+		size_t sum = 0;
+		for (size_t b = 0; b < 256; ++b) {
+			offsets[b] = sum;
+			sum += counts[d][b];
+		}
+		for (size_t i = 0; i < count; ++i) {
+			const uint8_t *id = from + (16 * i);
+			memcpy(to + (16 * offsets[id[d]]++), id, 16);
+		}
+		uint8_t *tmp = from;
+		from = to;
+		to = tmp;
+	}
+	if (from != ids) {
+		memcpy(ids, from, count * 16);
+	}
+
+	size_t run = 0;
+	for (size_t i = 1; i <= count; ++i) {
+		if (i == count || memcmp(ids + (16 * run), ids + (16 * i),
+					 UUID7_SORT_PREFIX)) {
+			uuid7_insertion_sort(ids + (16 * run), i - run);
+			run = i;
+		}
+	}
+}
+
+uint8_t *uuid7_sort(uint8_t *ids, size_t count)
+{
+	if (uuid7_sorted(ids, count)) {
+		return ids;
+	}
+	if (count < UUID7_SORT_SMALL) {
+		uuid7_insertion_sort(ids, count);
+		return ids;
+	}
+	uint8_t *scratch = (uint8_t *)uuid7_malloc(count * 16);
+	if (!scratch) {
+		qsort(ids, count, 16, uuid7_compare);
+		return ids;
+	}
+	uuid7_radix_sort(ids, scratch, count);
+	free(scratch);
+	return ids;
+}
+
+/* a binary min-heap of the next UUID of each run */
+struct uuid7_merge_head {
+	struct uuid7_u128 key;
+	const uint8_t *next;
+	const uint8_t *end;
+};
+
+static void uuid7_merge_down(struct uuid7_merge_head *heap, size_t len,
+			     size_t i)
+{
+	for (;;) {
+		size_t least = i;
+		size_t left = (2 * i) + 1;
+		size_t right = left + 1;
+		if (left < len
+		    && uuid7_u128_compare(heap[left].key,
+					  heap[least].key) < 0) {
+			least = left;
+		}
+		if (right < len
+		    && uuid7_u128_compare(heap[right].key,
+					  heap[least].key) < 0) {
+			least = right;
+		}
+		if (least == i) {
+			return;
+		}
+		struct uuid7_merge_head tmp = heap[i];
+		heap[i] = heap[least];
+		heap[least] = tmp;
+		i = least;
+	}
+}
+
+uint8_t *uuid7_merge(uint8_t *out, const uint8_t *const *runs,
+		     const size_t *lens, size_t num_runs)
+{
+	size_t total = 0;
+	size_t len = 0;
+	for (size_t r = 0; r < num_runs; ++r) {
+		total += lens[r];
+	}
+	struct uuid7_merge_head *heap = (struct uuid7_merge_head *)
+	    uuid7_malloc(sizeof(struct uuid7_merge_head) * (num_runs + 1));
+	if (!heap) {
+		memset(out, 0x00, total * 16);
+		return NULL;
+	}
+	for (size_t r = 0; r < num_runs; ++r) {
+		if (lens[r]) {
+			heap[len].key = uuid7_to_u128(runs[r]);
+			heap[len].next = runs[r];
+			heap[len].end = runs[r] + (16 * lens[r]);
+			++len;
+		}
+	}
+	for (size_t i = len / 2; i--;) {
+		uuid7_merge_down(heap, len, i);
+	}
+	uint8_t *pos = out;
+	while (len) {
+		memcpy(pos, heap[0].next, 16);
+		pos += 16;
+		heap[0].next += 16;
+		if (heap[0].next == heap[0].end) {
+			heap[0] = heap[--len];
+		} else {
+			heap[0].key = uuid7_to_u128(heap[0].next);
+		}
+		uuid7_merge_down(heap, len, 0);
+	}
+	free(heap);
+	return out;
+}
+
+size_t uuid7_dedupe(uint8_t *ids, size_t count)
+{
+	size_t kept = count ? 1 : 0;
+	for (size_t i = 1; i < count; ++i) {
+		if (!uuid7_equal(ids + (16 * (kept - 1)), ids + (16 * i))) {
+			memmove(ids + (16 * kept), ids + (16 * i), 16);
+			++kept;
+		}
+	}
+	return kept;
+}
+
+/* the first index of which the id compares greater than (or equal) */
+static size_t uuid7_bound(const uint8_t *ids, size_t count,
+			  const uint8_t *key, int or_equal)
+{
+	struct uuid7_u128 k = uuid7_to_u128(key);
+	size_t lo = 0;
+	size_t hi = count;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		struct uuid7_u128 v = uuid7_to_u128(ids + (16 * mid));
+		int cmp = uuid7_u128_compare(v, k);
+		if (cmp < 0 || (cmp == 0 && !or_equal)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+size_t uuid7_lower_bound(const uint8_t *ids, size_t count,
+			 const uint8_t *key)
+{
+	return uuid7_bound(ids, count, key, 1);
+}
+
+size_t uuid7_upper_bound(const uint8_t *ids, size_t count,
+			 const uint8_t *key)
+{
+	return uuid7_bound(ids, count, key, 0);
+}
+
+size_t uuid7_time_range(const uint8_t *ids, size_t count,
+			struct timespec begin, struct timespec end,
+			unsigned layout, size_t *first)
+{
+	uint8_t min[16];
+	uint8_t max[16];
+	uuid7_min_for_time(min, begin, layout);
+	uuid7_max_for_time(max, end, layout);
+	size_t from = uuid7_lower_bound(ids, count, min);
+	size_t until = uuid7_upper_bound(ids, count, max);
+	if (first) {
+		*first = from;
+	}
+	return (until > from) ? (until - from) : 0;
+}
+
+#if !(UUID7_NO_THREADS)
+struct uuid7_sort_task {
+	uint8_t *ids;
+	size_t count;
+};
+
+static int uuid7_sort_thread_func(void *context)
+{
+	struct uuid7_sort_task *task = (struct uuid7_sort_task *)context;
+	uuid7_sort(task->ids, task->count);
+	return 0;
+}
+#endif
+
+uint8_t *uuid7_sort_parallel(uint8_t *ids, size_t count, size_t threads)
+{
+#if (UUID7_NO_THREADS)
+	(void)threads;
+	return uuid7_sort(ids, count);
+#else
+	threads = (threads > UUID7_SORT_MAX_THREADS)
+	    ? UUID7_SORT_MAX_THREADS : threads;
+	if (threads < 2 || count < (threads * UUID7_SORT_SMALL)) {
+		return uuid7_sort(ids, count);
+	}
+
+	/* sort a part in each thread, or in this one if none can start */
+	struct uuid7_sort_task tasks[UUID7_SORT_MAX_THREADS];
+	thrd_t thread_ids[UUID7_SORT_MAX_THREADS];
+	int started[UUID7_SORT_MAX_THREADS];
+	const uint8_t *runs[UUID7_SORT_MAX_THREADS];
+	size_t lens[UUID7_SORT_MAX_THREADS];
+	size_t per_thread = count / threads;
+	for (size_t t = 0; t < threads; ++t) {
+		tasks[t].ids = ids + (16 * per_thread * t);
+		tasks[t].count = (t + 1 < threads) ? per_thread
+		    : (count - (per_thread * t));
+		runs[t] = tasks[t].ids;
+		lens[t] = tasks[t].count;
+		started[t] = uuid7_thrd_create(&thread_ids[t],
+					       uuid7_sort_thread_func,
+					       &tasks[t]) == thrd_success;
+		if (!started[t]) {
+			uuid7_sort_thread_func(&tasks[t]);
+		}
+	}
+	for (size_t t = 0; t < threads; ++t) {
+		if (started[t]) {
+			thrd_join(thread_ids[t], NULL);
+		}
+	}
+
+	uint8_t *merged = (uint8_t *)uuid7_malloc(count * 16);
+	if (!merged || !uuid7_merge(merged, runs, lens, threads)) {
+		free(merged);
+		return uuid7_sort(ids, count);
+	}
+	memcpy(ids, merged, count * 16);
+	free(merged);
+	return ids;
+#endif
+}
+
+/*
+   For 16 bytes, the 32 hex digits are two shuffles of a 16 entry table,
+   interleaved; then two more shuffles open the gaps for the dashes.
+   An index with the high bit set shuffles in a zero, to be OR'd with '-'
+*/
+#if !defined(UUID7_NO_SIMD) && defined(__GNUC__) \
+	&& (defined(__x86_64__) || defined(__i386__))
+#define UUID7_HEX_SSSE3 1
+#include <immintrin.h>
+#elif !defined(UUID7_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#define UUID7_HEX_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(UUID7_HEX_SSSE3) || defined(UUID7_HEX_NEON)
+static const uint8_t uuid7_hex_digits[16] = {
+	'0', '1', '2', '3', '4', '5', '6', '7',
+	'8', '9', 'a', 'b', 'c', 'd', 'e', 'f'
+};
+
+/* output bytes 0-15 from digits 0-15, output 16-31 from digits 14-29 */
+static const uint8_t uuid7_hex_gaps[2][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 0x80, 8, 9, 10, 11, 0x80, 12, 13 },
+	{ 0, 1, 0x80, 2, 3, 4, 5, 0x80, 6, 7, 8, 9, 10, 11, 12, 13 }
+};
+
+static const uint8_t uuid7_hex_dashes[2][16] = {
+	{ 0, 0, 0, 0, 0, 0, 0, 0, '-', 0, 0, 0, 0, '-', 0, 0 },
+	{ 0, 0, '-', 0, 0, 0, 0, '-', 0, 0, 0, 0, 0, 0, 0, 0 }
+};
+#endif
+
+/* for UUID7_DEBUG, allow forcing the scalar formatter at runtime */
+#ifdef UUID7_DEBUG
+int uuid7_hex_simd = 1;
+#else
+#define uuid7_hex_simd 1
+#endif
+
+#ifdef UUID7_HEX_SSSE3
+__attribute__((target("ssse3")))
+static void uuid7_hex36_ssse3(char *dst, const uint8_t *bytes)
+{
+	const __m128i *gaps = (const __m128i *)uuid7_hex_gaps;
+	const __m128i *dashes = (const __m128i *)uuid7_hex_dashes;
+	__m128i digits = _mm_loadu_si128((const __m128i *)uuid7_hex_digits);
+	__m128i nib_mask = _mm_set1_epi8(0x0F);
+
+	__m128i v = _mm_loadu_si128((const __m128i *)bytes);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nib_mask);
+	__m128i lo = _mm_and_si128(v, nib_mask);
+	hi = _mm_shuffle_epi8(digits, hi);
+	lo = _mm_shuffle_epi8(digits, lo);
+
+	__m128i a = _mm_unpacklo_epi8(hi, lo);
+	__m128i b = _mm_unpackhi_epi8(hi, lo);
+
+	__m128i out0 = _mm_or_si128(_mm_shuffle_epi8(a, _mm_loadu_si128(gaps)),
+				    _mm_loadu_si128(dashes));
+	__m128i mid = _mm_alignr_epi8(b, a, 14);
+	__m128i out1 =
+	    _mm_or_si128(_mm_shuffle_epi8(mid, _mm_loadu_si128(gaps + 1)),
+			 _mm_loadu_si128(dashes + 1));
+
+	_mm_storeu_si128((__m128i *)dst, out0);
+	_mm_storeu_si128((__m128i *)(dst + 16), out1);
+	uint32_t tail = (uint32_t)_mm_extract_epi16(b, 6)
+	    | (((uint32_t)_mm_extract_epi16(b, 7)) << 16);
+	memcpy(dst + 32, &tail, 4);
+}
+#endif
+
+#ifdef UUID7_HEX_NEON
+static void uuid7_hex36_neon(char *dst, const uint8_t *bytes)
+{
+	uint8x16_t digits = vld1q_u8(uuid7_hex_digits);
+
+	uint8x16_t v = vld1q_u8(bytes);
+	uint8x16_t hi = vqtbl1q_u8(digits, vshrq_n_u8(v, 4));
+	uint8x16_t lo = vqtbl1q_u8(digits, vandq_u8(v, vdupq_n_u8(0x0F)));
+
+	uint8x16_t a = vzip1q_u8(hi, lo);
+	uint8x16_t b = vzip2q_u8(hi, lo);
+
+	uint8x16_t out0 = vorrq_u8(vqtbl1q_u8(a, vld1q_u8(uuid7_hex_gaps[0])),
+				   vld1q_u8(uuid7_hex_dashes[0]));
+	uint8x16_t mid = vextq_u8(a, b, 14);
+	uint8x16_t out1 =
+	    vorrq_u8(vqtbl1q_u8(mid, vld1q_u8(uuid7_hex_gaps[1])),
+		     vld1q_u8(uuid7_hex_dashes[1]));
+
+	vst1q_u8((uint8_t *)dst, out0);
+	vst1q_u8((uint8_t *)(dst + 16), out1);
+	uint32_t tail = vgetq_lane_u32(vreinterpretq_u32_u8(b), 3);
+	memcpy(dst + 32, &tail, 4);
+}
+#endif
+
+static void uuid7_hex36_n(char *out, const uint8_t *ids, size_t count,
+			  size_t stride)
+{
+	void (*hex36)(char *dst, const uint8_t *bytes) = uuid7_hex36;
+#if defined(UUID7_HEX_SSSE3)
+	if (uuid7_hex_simd && __builtin_cpu_supports("ssse3")) {
+		hex36 = uuid7_hex36_ssse3;
+	}
+#elif defined(UUID7_HEX_NEON)
+	if (uuid7_hex_simd) {
+		hex36 = uuid7_hex36_neon;
+	}
+#endif
+	for (size_t i = 0; i < count; ++i) {
+		char *dst = out + (i * stride);
+		hex36(dst, ids + (i * 16));
+		if (stride > 36) {
+			dst[36] = '\0';
+		}
+	}
+}
+
+char *uuid7_to_string_n(char *out, size_t out_size, const uint8_t *ids,
+			size_t count, size_t stride)
+{
+	assert(out);
+	size_t need = SIZE_MAX;
+	if ((stride == 36 || stride == 37) && (count <= (SIZE_MAX / stride))) {
+		need = count * stride;
+	}
+	if (need > out_size) {
+		memset(out, 0x00, out_size);
+		return NULL;
+	}
+	uuid7_hex36_n(out, ids, count, stride);
+	return out;
+}
+
+/*
+   Parsing is the reverse: gather the 32 hex digits in to two registers,
+   check each is 0-9, a-f, or A-F, then combine each pair of nibbles.
+   Returns non-zero if all 32 were hex digits.
+*/
+#ifdef UUID7_HEX_SSSE3
+/* canonical digits 0-15 are in string 0-15 and 16-17 of 0-35 */
+static const uint8_t uuid7_hex_ungaps[4][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 14, 15, 0x80, 0x80 },
+	{ 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0, 1 },
+	{ 3, 4, 5, 6, 8, 9, 10, 11, 12, 13, 14, 15,
+	 0x80, 0x80, 0x80, 0x80 },
+	{ 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	 0x80, 0x80, 0x80, 0x80, 0, 1, 2, 3 }
+};
+
+__attribute__((target("ssse3")))
+static __m128i uuid7_unhex16_ssse3(__m128i h, int *valid)
+{
+	__m128i lower = _mm_or_si128(h, _mm_set1_epi8(0x20));
+	__m128i is_digit =
+	    _mm_and_si128(_mm_cmpgt_epi8(h, _mm_set1_epi8('0' - 1)),
+			  _mm_cmplt_epi8(h, _mm_set1_epi8('9' + 1)));
+	__m128i is_alpha =
+	    _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+			  _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+	*valid &= (_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha))
+		   == 0xFFFF);
+
+	__m128i digit = _mm_sub_epi8(h, _mm_set1_epi8('0'));
+	__m128i alpha = _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10));
+	__m128i nibs = _mm_or_si128(_mm_and_si128(is_digit, digit),
+				    _mm_and_si128(is_alpha, alpha));
+
+	/* (high nibble * 16) + (low nibble * 1), as 8 uint16_t */
+	return _mm_maddubs_epi16(nibs, _mm_set1_epi16(0x0110));
+}
+
+__attribute__((target("ssse3")))
+static int uuid7_unhex32_ssse3(uint8_t *ubuf, const char *str, int dashed)
+{
+	__m128i h0, h1;
+	if (dashed) {
+		const __m128i *ungaps = (const __m128i *)uuid7_hex_ungaps;
+		uint32_t tail;
+		memcpy(&tail, str + 32, 4);
+		__m128i s0 = _mm_loadu_si128((const __m128i *)str);
+		__m128i s1 = _mm_loadu_si128((const __m128i *)(str + 16));
+		__m128i s2 = _mm_cvtsi32_si128((int)tail);
+		__m128i g0 = _mm_loadu_si128(ungaps);
+		__m128i g1 = _mm_loadu_si128(ungaps + 1);
+		__m128i g2 = _mm_loadu_si128(ungaps + 2);
+		__m128i g3 = _mm_loadu_si128(ungaps + 3);
+		h0 = _mm_or_si128(_mm_shuffle_epi8(s0, g0),
+				  _mm_shuffle_epi8(s1, g1));
+		h1 = _mm_or_si128(_mm_shuffle_epi8(s1, g2),
+				  _mm_shuffle_epi8(s2, g3));
+	} else {
+		h0 = _mm_loadu_si128((const __m128i *)str);
+		h1 = _mm_loadu_si128((const __m128i *)(str + 16));
+	}
+	int valid = 1;
+	__m128i b0 = uuid7_unhex16_ssse3(h0, &valid);
+	__m128i b1 = uuid7_unhex16_ssse3(h1, &valid);
+	_mm_storeu_si128((__m128i *)ubuf, _mm_packus_epi16(b0, b1));
+	return valid;
+}
+#endif
+
+#ifdef UUID7_HEX_NEON
+/* canonical digits 0-15 and 16-31, from a 32 byte table of string 0-31 */
+static const uint8_t uuid7_hex_ungaps[2][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 14, 15, 16, 17 },
+	{ 19, 20, 21, 22, 24, 25, 26, 27, 28, 29, 30, 31,
+	 0xFF, 0xFF, 0xFF, 0xFF }
+};
+
+static uint8x16_t uuid7_unhex16_neon(uint8x16_t h, uint8x16_t *valid)
+{
+	uint8x16_t lower = vorrq_u8(h, vdupq_n_u8(0x20));
+	uint8x16_t digit = vsubq_u8(h, vdupq_n_u8('0'));
+	uint8x16_t alpha = vsubq_u8(lower, vdupq_n_u8('a' - 10));
+	uint8x16_t is_digit = vcltq_u8(digit, vdupq_n_u8(10));
+	uint8x16_t is_alpha = vandq_u8(vcgeq_u8(alpha, vdupq_n_u8(10)),
+				       vcltq_u8(alpha, vdupq_n_u8(16)));
+	*valid = vandq_u8(*valid, vorrq_u8(is_digit, is_alpha));
+	return vorrq_u8(vandq_u8(is_digit, digit), vandq_u8(is_alpha, alpha));
+}
+
+static int uuid7_unhex32_neon(uint8_t *ubuf, const char *str, int dashed)
+{
+	uint8x16_t h0, h1;
+	if (dashed) {
+		uint8x16x2_t s;
+		s.val[0] = vld1q_u8((const uint8_t *)str);
+		s.val[1] = vld1q_u8((const uint8_t *)(str + 16));
+		uint8_t tail[16] = { 0 };
+		memcpy(tail + 12, str + 32, 4);
+		h0 = vqtbl2q_u8(s, vld1q_u8(uuid7_hex_ungaps[0]));
+		h1 = vorrq_u8(vqtbl2q_u8(s, vld1q_u8(uuid7_hex_ungaps[1])),
+			      vld1q_u8(tail));
+	} else {
+		h0 = vld1q_u8((const uint8_t *)str);
+		h1 = vld1q_u8((const uint8_t *)(str + 16));
+	}
+	uint8x16_t valid = vdupq_n_u8(0xFF);
+	uint8x16_t n0 = uuid7_unhex16_neon(h0, &valid);
+	uint8x16_t n1 = uuid7_unhex16_neon(h1, &valid);
+	uint8x16_t hi = vuzp1q_u8(n0, n1);
+	uint8x16_t lo = vuzp2q_u8(n0, n1);
+	vst1q_u8(ubuf, vorrq_u8(vshlq_n_u8(hi, 4), lo));
+	return vminvq_u8(valid) == 0xFF;
+}
+#endif
+
+static int uuid7_unhex_nib(char c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return 10 + (c - 'a');
+	}
+	if (c >= 'A' && c <= 'F') {
+		return 10 + (c - 'A');
+	}
+	return -1;
+}
+
+static int uuid7_unhex32(uint8_t *ubuf, const char *str, int dashed)
+{
+	int valid = 1;
+	size_t pos = 0;
+	for (size_t i = 0; i < 16; ++i) {
+		if (dashed && (i == 4 || i == 6 || i == 8 || i == 10)) {
+			++pos;
+		}
+		int hi = uuid7_unhex_nib(str[pos++]);
+		int lo = uuid7_unhex_nib(str[pos++]);
+		valid &= (hi >= 0 && lo >= 0);
+		ubuf[i] = (uint8_t)(((hi & 0x0F) << 4) | (lo & 0x0F));
+	}
+	return valid;
+}
+
+/* 36 for 8-4-4-4-12, 32 for bare hex, or 0 if neither */
+static int uuid7_unhex_form(const char *str, size_t str_len)
+{
+	if (str_len == 32) {
+		return 32;
+	}
+	if (str_len == 36 && str[8] == '-' && str[13] == '-'
+	    && str[18] == '-' && str[23] == '-') {
+		return 36;
+	}
+	return 0;
+}
+
+static uint8_t *uuid7_from_strings(uint8_t *out, const char *strs,
+				   size_t count, size_t str_len, size_t stride)
+{
+	int (*unhex32)(uint8_t *ubuf, const char *str, int dashed) =
+	    uuid7_unhex32;
+#if defined(UUID7_HEX_SSSE3)
+	if (uuid7_hex_simd && __builtin_cpu_supports("ssse3")) {
+		unhex32 = uuid7_unhex32_ssse3;
+	}
+#elif defined(UUID7_HEX_NEON)
+	if (uuid7_hex_simd) {
+		unhex32 = uuid7_unhex32_neon;
+	}
+#endif
+	uint8_t *rv = out;
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t *ubuf = out + (i * 16);
+		const char *str = strs + (i * stride);
+		int form = uuid7_unhex_form(str, str_len);
+		struct uuid7 u;
+		if (!form || !unhex32(ubuf, str, form == 36)
+		    || !uuid7_parts(&u, ubuf)) {
+			memset(ubuf, 0x00, 16);
+			rv = NULL;
+		}
+	}
+	return rv;
+}
+
+uint8_t *uuid7_from_string(uint8_t *ubuf, const char *str, size_t str_len)
+{
+	assert(ubuf);
+	assert(str);
+	return uuid7_from_strings(ubuf, str, 1, str_len, str_len);
+}
+
+uint8_t *uuid7_from_string_n(uint8_t *out, const char *strs, size_t count,
+			     size_t str_len, size_t stride)
+{
+	assert(out);
+	assert(strs);
+	if (count > (SIZE_MAX / 16)) {
+		return NULL;
+	}
+	if (stride < str_len) {
+		memset(out, 0x00, count * 16);
+		return NULL;
+	}
+	return uuid7_from_strings(out, strs, count, str_len, stride);
+}
+
+/*
+   Crockford base32 is the 128 bits as a 130 bit number, with two leading
+   zero bits, 5 bits to a character, most significant first, of digits
+   in ASCII order, thus the strings sort as the UUIDs. base64url (RFC 4648
+   section 5, without padding) is 6 bits to a character, the last with
+   4 zero bits; shorter, but the strings do not sort as the UUIDs.
+*/
+static const char uuid7_base32_digits[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+static const char uuid7_base64url_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/* of ASCII, the value of a digit, or -1; I and L are 1, O is 0 */
+static const int8_t uuid7_base32_values[128] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, 16, 17, 1, 18, 19, 1, 20, 21, 0,
+	22, 23, 24, 25, 26, -1, 27, 28, 29, 30, 31, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, 16, 17, 1, 18, 19, 1, 20, 21, 0,
+	22, 23, 24, 25, 26, -1, 27, 28, 29, 30, 31, -1, -1, -1, -1, -1,
+};
+
+static const int8_t uuid7_base64url_values[128] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1,
+	52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+	-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, 63,
+	-1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+};
+
+/* the bits of v from shift up, or if shift is negative, v << -shift */
+static unsigned uuid7_bits_of(struct uuid7_u128 v, int shift, unsigned mask)
+{
+	uint64_t bits;
+	if (shift < 0) {
+		bits = v.lo << -shift;
+	} else if (shift >= 64) {
+		bits = v.hi >> (shift - 64);
+	} else if (shift == 0) {
+		bits = v.lo;
+	} else {
+		bits = (v.lo >> shift) | (v.hi << (64 - shift));
+	}
+	return bits & mask;
+}
+
+static void uuid7_base32_26(char *dst, const uint8_t *bytes)
+{
+	struct uuid7_u128 v = uuid7_to_u128(bytes);
+	for (int i = 0; i < 26; ++i) {
+		dst[i] = uuid7_base32_digits[uuid7_bits_of(v, 125 - (5 * i),
+							   0x1F)];
+	}
+}
+
+static void uuid7_base64url_22(char *dst, const uint8_t *bytes)
+{
+	struct uuid7_u128 v = uuid7_to_u128(bytes);
+	for (int i = 0; i < 22; ++i) {
+		dst[i] = uuid7_base64url_digits[uuid7_bits_of(v, 122 - (6 * i),
+							      0x3F)];
+	}
+}
+
+#ifdef UUID7_HEX_SSSE3
+/*
+   Each character is 5 (or 6) bits, within 2 bytes. A shuffle places the
+   2 bytes of each in a 16 bit lane, big-endian, and a multiply-high by
+   2^(16 - shift) shifts each lane by its own amount; 8 characters to a
+   register. The digits are then looked up 16 at a time.
+*/
+static const uint8_t uuid7_base32_shuffle[4][16] = {
+	{ 1, 0, 1, 0, 2, 1, 2, 1, 3, 2, 3, 2, 4, 3, 5, 4 },
+	{ 5, 4, 6, 5, 7, 6, 7, 6, 8, 7, 8, 7, 9, 8, 10, 9 },
+	{ 10, 9, 11, 10, 12, 11, 12, 11, 13, 12, 13, 12, 14, 13, 15, 14 },
+	{ 15, 14, 0x80, 15, 0x80, 0x80, 0x80, 0x80,
+	 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+};
+
+static const uint16_t uuid7_base32_mult[4][8] = {
+	{ 8, 256, 32, 1024, 128, 4096, 512, 64 },
+	{ 2048, 256, 32, 1024, 128, 4096, 512, 64 },
+	{ 2048, 256, 32, 1024, 128, 4096, 512, 64 },
+	{ 2048, 256, 0, 0, 0, 0, 0, 0 },
+};
+
+static const uint8_t uuid7_base64url_shuffle[3][16] = {
+	{ 1, 0, 1, 0, 2, 1, 3, 2, 4, 3, 4, 3, 5, 4, 6, 5 },
+	{ 7, 6, 7, 6, 8, 7, 9, 8, 10, 9, 10, 9, 11, 10, 12, 11 },
+	{ 13, 12, 13, 12, 14, 13, 15, 14,
+	 0x80, 15, 0x80, 15, 0x80, 0x80, 0x80, 0x80 },
+};
+
+static const uint16_t uuid7_base64url_mult[3][8] = {
+	{ 64, 4096, 1024, 256, 64, 4096, 1024, 256 },
+	{ 64, 4096, 1024, 256, 64, 4096, 1024, 256 },
+	{ 64, 4096, 1024, 256, 64, 4096, 0, 0 },
+};
+
+__attribute__((target("ssse3")))
+static __m128i uuid7_fields_ssse3(__m128i v, const uint8_t *shuffle,
+				  const uint16_t *mult, __m128i mask)
+{
+	__m128i w = _mm_shuffle_epi8(v, _mm_loadu_si128((const __m128i *)
+							shuffle));
+	w = _mm_mulhi_epu16(w, _mm_loadu_si128((const __m128i *)mult));
+	return _mm_and_si128(w, mask);
+}
+
+/* the digit of each value, of a table of 16 * tables digits */
+__attribute__((target("ssse3")))
+static __m128i uuid7_digits_ssse3(__m128i values, const char *digits,
+				  int tables)
+{
+	__m128i out = _mm_setzero_si128();
+	__m128i low = _mm_and_si128(values, _mm_set1_epi8(0x0F));
+	__m128i high = _mm_and_si128(_mm_srli_epi16(values, 4),
+				     _mm_set1_epi8(0x0F));
+	for (int t = 0; t < tables; ++t) {
+		__m128i table =
+		    _mm_loadu_si128((const __m128i *)(digits + (16 * t)));
+		__m128i which = _mm_cmpeq_epi8(high, _mm_set1_epi8(t));
+		out = _mm_or_si128(out, _mm_and_si128(which,
+						      _mm_shuffle_epi8(table,
+								       low)));
+	}
+	return out;
+}
+
+__attribute__((target("ssse3")))
+static void uuid7_base32_26_ssse3(char *dst, const uint8_t *bytes)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)bytes);
+	__m128i mask = _mm_set1_epi16(0x1F);
+	__m128i f[4];
+	for (int r = 0; r < 4; ++r) {
+		f[r] = uuid7_fields_ssse3(v, uuid7_base32_shuffle[r],
+					  uuid7_base32_mult[r], mask);
+	}
+	__m128i a = uuid7_digits_ssse3(_mm_packus_epi16(f[0], f[1]),
+				       uuid7_base32_digits, 2);
+	__m128i b = uuid7_digits_ssse3(_mm_packus_epi16(f[2], f[3]),
+				       uuid7_base32_digits, 2);
+	char tail[16];
+	_mm_storeu_si128((__m128i *)dst, a);
+	_mm_storeu_si128((__m128i *)tail, b);
+	memcpy(dst + 16, tail, 10);
+}
+
+__attribute__((target("ssse3")))
+static void uuid7_base64url_22_ssse3(char *dst, const uint8_t *bytes)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)bytes);
+	__m128i mask = _mm_set1_epi16(0x3F);
+	__m128i f[3];
+	for (int r = 0; r < 3; ++r) {
+		f[r] = uuid7_fields_ssse3(v, uuid7_base64url_shuffle[r],
+					  uuid7_base64url_mult[r], mask);
+	}
+	__m128i a = uuid7_digits_ssse3(_mm_packus_epi16(f[0], f[1]),
+				       uuid7_base64url_digits, 4);
+	__m128i b = uuid7_digits_ssse3(_mm_packus_epi16(f[2], f[2]),
+				       uuid7_base64url_digits, 4);
+	char tail[16];
+	_mm_storeu_si128((__m128i *)dst, a);
+	_mm_storeu_si128((__m128i *)tail, b);
+	memcpy(dst + 16, tail, 6);
+}
+#endif
+
+typedef void (*uuid7_encode_fn)(char *dst, const uint8_t *bytes);
+
+static char *uuid7_encode_n(char *out, size_t out_size, const uint8_t *ids,
+			    size_t count, size_t stride, size_t width,
+			    uuid7_encode_fn encode)
+{
+	assert(out);
+	size_t need = SIZE_MAX;
+	if ((stride == width || stride == width + 1)
+	    && (count <= (SIZE_MAX / stride))) {
+		need = count * stride;
+	}
+	if (need > out_size) {
+		memset(out, 0x00, out_size);
+		return NULL;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		char *dst = out + (i * stride);
+		encode(dst, ids + (i * 16));
+		if (stride > width) {
+			dst[width] = '\0';
+		}
+	}
+	return out;
+}
+
+static uuid7_encode_fn uuid7_base32_encoder(void)
+{
+#if defined(UUID7_HEX_SSSE3)
+	if (uuid7_hex_simd && __builtin_cpu_supports("ssse3")) {
+		return uuid7_base32_26_ssse3;
+	}
+#endif
+	return uuid7_base32_26;
+}
+
+static uuid7_encode_fn uuid7_base64url_encoder(void)
+{
+#if defined(UUID7_HEX_SSSE3)
+	if (uuid7_hex_simd && __builtin_cpu_supports("ssse3")) {
+		return uuid7_base64url_22_ssse3;
+	}
+#endif
+	return uuid7_base64url_22;
+}
+
+char *uuid7_to_base32_n(char *out, size_t out_size, const uint8_t *ids,
+			size_t count, size_t stride)
+{
+	return uuid7_encode_n(out, out_size, ids, count, stride, 26,
+			      uuid7_base32_encoder());
+}
+
+char *uuid7_to_base64url_n(char *out, size_t out_size, const uint8_t *ids,
+			   size_t count, size_t stride)
+{
+	return uuid7_encode_n(out, out_size, ids, count, stride, 22,
+			      uuid7_base64url_encoder());
+}
+
+char *uuid7_to_base32(char *buf, size_t buf_size, const uint8_t *bytes)
+{
+	assert(buf);
+	memset(buf, 0x00, uuid7_minz(27, buf_size));
+	if (buf_size < 27) {
+		return NULL;
+	}
+	uuid7_base32_encoder()(buf, bytes);
+	return buf;
+}
+
+char *uuid7_to_base64url(char *buf, size_t buf_size, const uint8_t *bytes)
+{
+	assert(buf);
+	memset(buf, 0x00, uuid7_minz(23, buf_size));
+	if (buf_size < 23) {
+		return NULL;
+	}
+	uuid7_base64url_encoder()(buf, bytes);
+	return buf;
+}
+
+/* shift len digits in to v, returns 0 if each is a digit, else -1 */
+static int uuid7_undigits(struct uuid7_u128 *v, const char *str, size_t len,
+			  const int8_t *values, unsigned bits)
+{
+	for (size_t i = 0; i < len; ++i) {
+		uint8_t c = (uint8_t)str[i];
+		int value = (c < 128) ? values[c] : -1;
+		if (value < 0) {
+			return -1;
+		}
+		v->hi = (v->hi << bits) | (v->lo >> (64 - bits));
+		v->lo = (v->lo << bits) | (unsigned)value;
+	}
+	return 0;
+}
+
+/* the first digit carries only the 3 most significant bits */
+static int uuid7_unbase32_26(struct uuid7_u128 *v, const char *str)
+{
+	if (uuid7_undigits(v, str, 26, uuid7_base32_values, 5)) {
+		return -1;
+	}
+	return (uuid7_base32_values[(uint8_t)str[0]] > 7) ? -1 : 0;
+}
+
+/* the last digit carries the 2 least significant bits, then 4 zero bits */
+static int uuid7_unbase64url_22(struct uuid7_u128 *v, const char *str)
+{
+	if (uuid7_undigits(v, str, 21, uuid7_base64url_values, 6)) {
+		return -1;
+	}
+	uint8_t c = (uint8_t)str[21];
+	int last = (c < 128) ? uuid7_base64url_values[c] : -1;
+	if (last < 0 || (last & 0x0F)) {
+		return -1;
+	}
+	v->hi = (v->hi << 2) | (v->lo >> 62);
+	v->lo = (v->lo << 2) | ((unsigned)last >> 4);
+	return 0;
+}
+
+static uint8_t *uuid7_decode_n(uint8_t *out, const char *strs, size_t count,
+			       size_t stride,
+			       int (*decode)(struct uuid7_u128 *v,
+					     const char *str))
+{
+	uint8_t *rv = out;
+	for (size_t i = 0; i < count; ++i) {
+		uint8_t *ubuf = out + (i * 16);
+		struct uuid7_u128 v = { 0, 0 };
+		struct uuid7 u;
+		if (decode(&v, strs + (i * stride))
+		    || !uuid7_parts(&u, uuid7_from_u128(ubuf, v))) {
+			memset(ubuf, 0x00, 16);
+			rv = NULL;
+		}
+	}
+	return rv;
+}
+
+uint8_t *uuid7_from_base32(uint8_t *ubuf, const char *str, size_t str_len)
+{
+	assert(ubuf);
+	assert(str);
+	if (str_len != 26) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+	return uuid7_decode_n(ubuf, str, 1, 26, uuid7_unbase32_26);
+}
+
+uint8_t *uuid7_from_base32_n(uint8_t *out, const char *strs, size_t count,
+			     size_t stride)
+{
+	assert(out);
+	assert(strs);
+	if (count > (SIZE_MAX / 16)) {
+		return NULL;
+	}
+	if (stride < 26) {
+		memset(out, 0x00, count * 16);
+		return NULL;
+	}
+	return uuid7_decode_n(out, strs, count, stride, uuid7_unbase32_26);
+}
+
+uint8_t *uuid7_from_base64url(uint8_t *ubuf, const char *str, size_t str_len)
+{
+	assert(ubuf);
+	assert(str);
+	if (str_len != 22) {
+		memset(ubuf, 0x00, 16);
+		return NULL;
+	}
+	return uuid7_decode_n(ubuf, str, 1, 22, uuid7_unbase64url_22);
+}
+
+uint8_t *uuid7_from_base64url_n(uint8_t *out, const char *strs, size_t count,
+				size_t stride)
+{
+	assert(out);
+	assert(strs);
+	if (count > (SIZE_MAX / 16)) {
+		return NULL;
+	}
+	if (stride < 22) {
+		memset(out, 0x00, count * 16);
+		return NULL;
+	}
+	return uuid7_decode_n(out, strs, count, stride, uuid7_unbase64url_22);
+}
+
+/*
+   Validating is of the first 8 bytes, big-endian, as the number hi, and
+   the top 2 bits of byte 8: the version nibble of hi must be 7, the
+   variant either of ours or of RFC 9562, and hi within the window of
+   the layout of the variant, the hi of the lowest UUID of min_ns through
+   the hi of the highest of max_ns.
+*/
+struct uuid7_window {
+	uint64_t min[2];
+	uint64_t max[2];
+};
+
+static void uuid7_window_init(struct uuid7_window *w, uint64_t min_ns,
+			      uint64_t max_ns)
+{
+	struct timespec min_ts = { 0, 0 };
+	struct timespec max_ts = { 0, 0 };
+	min_ts.tv_sec = (time_t)(min_ns / (1000 * 1000 * 1000));
+	min_ts.tv_nsec = (long)(min_ns % (1000 * 1000 * 1000));
+	max_ts.tv_sec = (time_t)(max_ns / (1000 * 1000 * 1000));
+	max_ts.tv_nsec = (long)(max_ns % (1000 * 1000 * 1000));
+	uint8_t ubuf[16];
+	for (unsigned layout = 0; layout < 2; ++layout) {
+		uuid7_min_for_time(ubuf, min_ts, layout);
+		w->min[layout] = uuid7_load_be64(ubuf);
+		uuid7_max_for_time(ubuf, max_ts, layout);
+		w->max[layout] = uuid7_load_be64(ubuf);
+	}
+}
+
+static size_t uuid7_validate_scalar(const uint8_t *ids, size_t count,
+				    uint8_t *ok_mask,
+				    const struct uuid7_window *w)
+{
+	size_t valid = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const uint8_t *id = ids + (16 * i);
+		uint64_t hi = uuid7_load_be64(id);
+		unsigned variant = (id[8] & 0xC0) >> 6;
+		size_t layout = (variant == UUID7_VARIANT_RFC9562);
+		int ok = ((hi & 0xF000) == (UUID7_VERSION << 12))
+		    & ((variant == UUID7_VARIANT) | layout)
+		    & (hi >= w->min[layout])
+		    & (hi <= w->max[layout]);
+		ok_mask[i] = (uint8_t)ok;
+		valid += (size_t)ok;
+	}
+	return valid;
+}
+
+#ifdef UUID7_HEX_SSSE3
+/*
+   Two IDs to a pass: a shuffle swaps each in to two big-endian 64 bit
+   lanes, which are regrouped as the hi of each and the lo of each. The
+   window compares are signed, of SSE4.2, thus each side is offset by
+   2^63 to compare as unsigned.
+*/
+__attribute__((target("sse4.2")))
+static size_t uuid7_validate_sse42(const uint8_t *ids, size_t count,
+				   uint8_t *ok_mask,
+				   const struct uuid7_window *w)
+{
+	const __m128i bswap = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,
+					    15, 14, 13, 12, 11, 10, 9, 8);
+	const uint64_t offset = UINT64_C(1) << 63;
+	const __m128i flip = _mm_set1_epi64x((long long)offset);
+	__m128i mins[2];
+	__m128i maxs[2];
+	for (size_t l = 0; l < 2; ++l) {
+		mins[l] = _mm_set1_epi64x((long long)(w->min[l] ^ offset));
+		maxs[l] = _mm_set1_epi64x((long long)(w->max[l] ^ offset));
+	}
+	const __m128i ver_mask = _mm_set1_epi64x(0xF000);
+	const __m128i ver = _mm_set1_epi64x(UUID7_VERSION << 12);
+	const __m128i var = _mm_set1_epi64x(UUID7_VARIANT);
+	const __m128i var_rfc = _mm_set1_epi64x(UUID7_VARIANT_RFC9562);
+
+	size_t valid = 0;
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(ids + (16 * i)));
+		__m128i b =
+		    _mm_loadu_si128((const __m128i *)(ids + (16 * (i + 1))));
+		a = _mm_shuffle_epi8(a, bswap);
+		b = _mm_shuffle_epi8(b, bswap);
+		__m128i hi = _mm_unpacklo_epi64(a, b);
+		__m128i variant = _mm_srli_epi64(_mm_unpackhi_epi64(a, b), 62);
+		__m128i h = _mm_xor_si128(hi, flip);
+
+		__m128i ok = _mm_cmpeq_epi64(_mm_and_si128(hi, ver_mask), ver);
+		__m128i in[2];
+		for (size_t l = 0; l < 2; ++l) {
+			in[l] = _mm_or_si128(_mm_cmpgt_epi64(mins[l], h),
+					     _mm_cmpgt_epi64(h, maxs[l]));
+		}
+		__m128i in_window =
+		    _mm_or_si128(_mm_andnot_si128(in[0],
+						  _mm_cmpeq_epi64(variant,
+								  var)),
+				 _mm_andnot_si128(in[1],
+						  _mm_cmpeq_epi64(variant,
+								  var_rfc)));
+		ok = _mm_and_si128(ok, in_window);
+
+		int bits = _mm_movemask_pd(_mm_castsi128_pd(ok));
+		ok_mask[i] = (uint8_t)(bits & 1);
+		ok_mask[i + 1] = (uint8_t)(bits >> 1);
+		valid += (size_t)((bits & 1) + (bits >> 1));
+	}
+	return valid + uuid7_validate_scalar(ids + (16 * i), count - i,
+					     ok_mask + i, w);
+}
+#endif
+
+size_t uuid7_validate_n(const uint8_t *ids, size_t count, uint8_t *ok_mask,
+			uint64_t min_ns, uint64_t max_ns)
+{
+	assert(ids || !count);
+	assert(ok_mask || !count);
+	struct uuid7_window w;
+	uuid7_window_init(&w, min_ns, max_ns);
+#if defined(UUID7_HEX_SSSE3)
+	if (uuid7_hex_simd && __builtin_cpu_supports("sse4.2")) {
+		return uuid7_validate_sse42(ids, count, ok_mask, &w);
+	}
+#endif
+	return uuid7_validate_scalar(ids, count, ok_mask, &w);
 }
 
 #ifdef UUID7_WITH_MUTEX
 int uuid7_mutex_init(void)
 {
-	int rv = mtx_init(&uuid7_mutex, mtx_plain);
+	int rv = mtx_init(&uuid7_locked.mutex, mtx_plain);
 	if (rv == thrd_success) {
-		uuid7_mutex_initd = true;
+		uuid7_locked.initd = true;
 	}
 	return rv;
 }
 
 void uuid7_mutex_destroy(void)
 {
-	mtx_destroy(&uuid7_mutex);
-	uuid7_mutex_initd = false;
+	mtx_destroy(&uuid7_locked.mutex);
+	uuid7_locked.initd = false;
 }
 #endif
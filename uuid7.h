@@ -10,16 +10,355 @@ extern "C" {
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#define UUID7_VERSION 7
+#define UUID7_VARIANT 1
+/* the variant of UUIDs of the RFC 9562 layout, see uuid7_gen_layout */
+#define UUID7_VARIANT_RFC9562 2
 
 uint8_t *uuid7(uint8_t *ubuf);
 
+uint8_t *uuid7_n(uint8_t *out, size_t count);
+
+/*
+   With UUID7_HEADER_ONLY defined, the stateless routines below, which
+   encode, format, and decode, are "static inline" in each translation
+   unit which includes this header, rather than calls in to the library.
+   Generating remains in the library, as it needs the last issued UUID.
+*/
+#ifndef UUID7_HEADER_ONLY
 char *uuid7_to_string(char *buf, size_t buf_size, const uint8_t *bytes);
+#endif
+
+/*
+   Formats count UUIDs in to out, one every stride bytes: a stride of 36
+   places the strings back to back, a stride of 37 ends each with a NUL.
+*/
+char *uuid7_to_string_n(char *out, size_t out_size, const uint8_t *ids,
+			size_t count, size_t stride);
+
+/*
+   Parses str_len characters, either 36 of 8-4-4-4-12 or 32 bare hex
+   digits, of either case. Returns NULL and zeros ubuf if str is not a
+   version 7 UUID.
+*/
+uint8_t *uuid7_from_string(uint8_t *ubuf, const char *str, size_t str_len);
+
+/*
+   Parses count strings of str_len characters, one every stride bytes, as
+   with uuid7_from_string. If any is not a UUID, NULL is returned and
+   those IDs are zeroed; the other IDs are parsed.
+*/
+uint8_t *uuid7_from_string_n(uint8_t *out, const char *strs, size_t count,
+			     size_t str_len, size_t stride);
+
+/*
+   Crockford base32: 26 characters, of 0-9 and A-Z without I, L, O, and U,
+   which sort as the UUIDs sort. buf_size must be at least 27, for the NUL.
+   Parsing is of either case, reading I and L as 1, and O as 0.
+*/
+char *uuid7_to_base32(char *buf, size_t buf_size, const uint8_t *bytes);
+uint8_t *uuid7_from_base32(uint8_t *ubuf, const char *str, size_t str_len);
+
+/* as uuid7_to_string_n, with a stride of 26, or 27 to end each with NUL */
+char *uuid7_to_base32_n(char *out, size_t out_size, const uint8_t *ids,
+			size_t count, size_t stride);
+uint8_t *uuid7_from_base32_n(uint8_t *out, const char *strs, size_t count,
+			     size_t stride);
+
+/*
+   base64url, RFC 4648 section 5, without padding: 22 characters, of A-Z,
+   a-z, 0-9, '-' and '_', which do not sort as the UUIDs sort. buf_size
+   must be at least 23, for the NUL.
+*/
+char *uuid7_to_base64url(char *buf, size_t buf_size, const uint8_t *bytes);
+uint8_t *uuid7_from_base64url(uint8_t *ubuf, const char *str,
+			      size_t str_len);
+
+/* as uuid7_to_string_n, with a stride of 22, or 23 to end each with NUL */
+char *uuid7_to_base64url_n(char *out, size_t out_size, const uint8_t *ids,
+			   size_t count, size_t stride);
+uint8_t *uuid7_from_base64url_n(uint8_t *out, const char *strs, size_t count,
+				size_t stride);
+
+/*
+   Checks each of count untrusted IDs, as a gateway might, without a
+   struct uuid7: the version is 7, the variant is that of either layout,
+   and the time is from min_ns through max_ns since the epoch (to within
+   64 ns of the default layout, or the 1/4096 ms of RFC 9562). Sets each
+   byte of ok_mask to 1 if the ID is valid, else 0, and returns the number
+   of valid IDs. For no window, pass 0 and UINT64_MAX (the year 2554).
+*/
+size_t uuid7_validate_n(const uint8_t *ids, size_t count, uint8_t *ok_mask,
+			uint64_t min_ns, uint64_t max_ns);
 
 #ifdef UUID7_WITH_MUTEX
 int uuid7_mutex_init(void);
 void uuid7_mutex_destroy(void);
 #endif
 
+#ifdef UUID7_TSC
+/* the clock is read to calibrate, then once per period */
+#ifndef UUID7_TSC_CALIBRATE_NS
+#define UUID7_TSC_CALIBRATE_NS (1000 * 1000)
+#endif
+#ifndef UUID7_TSC_PERIOD_NS
+#define UUID7_TSC_PERIOD_NS (100 * 1000 * 1000)
+#endif
+#endif
+
+#ifdef UUID7_ADAPTIVE_SEQ
+/* at most the 6 bits of hiseq and the 12 bits of lofrac */
+#ifndef UUID7_ADAPTIVE_SEQ_MAX_BITS
+#define UUID7_ADAPTIVE_SEQ_MAX_BITS 18
+#endif
+#endif
+
+/* the ChaCha20 keystream is drawn through the entropy pool */
+#ifdef UUID7_CHACHA20
+#ifndef UUID7_ENTROPY_POOL
+#define UUID7_ENTROPY_POOL 1
+#endif
+/* refills of a buffer from the keystream before getrandom is called */
+#ifndef UUID7_CHACHA20_RESEED
+#define UUID7_CHACHA20_RESEED 256
+#endif
+#endif
+
+#ifdef UUID7_ENTROPY_POOL
+#ifndef UUID7_ENTROPY_POOL_SIZE
+#define UUID7_ENTROPY_POOL_SIZE 4096
+#endif
+void uuid7_entropy_reset(void);
+#elif defined(UUID7_FAST_RANDOM)
+void uuid7_entropy_reset(void);
+#endif
+
+#ifdef __cplusplus
+#define UUID7_ALIGNAS(x) alignas(x)
+#else
+#define UUID7_ALIGNAS(x) _Alignas(x)
+#endif
+
+/*
+   State written by one thread and read by others is aligned, and padded,
+   to UUID7_CACHE_LINE, thus never shares a line with other state. It is
+   128 where a line is 128 bytes (Apple M, POWER), or where the adjacent
+   line is prefetched in pairs (x86-64); the library and its callers must
+   agree on it, as it is the alignment of a struct uuid7_gen.
+*/
+#ifndef UUID7_CACHE_LINE
+#if defined(__x86_64__) || defined(__aarch64__) || defined(__powerpc64__)
+#define UUID7_CACHE_LINE 128
+#else
+#define UUID7_CACHE_LINE 64
+#endif
+#endif
+
+struct uuid7_entropy_buf {
+	uint8_t *bytes;
+	size_t size;
+	size_t pos;
+	size_t len;
+	unsigned fork_generation;
+	/* with UUID7_CHACHA20, the refills since getrandom was called */
+	unsigned refills;
+};
+
+/*
+   A caller-owned generator: its own last issued UUID, segment, and an
+   optional buffer for random bytes. A generator needs neither locks nor
+   thread_local storage, but must not be used by two threads at once.
+   Each generator starts on its own cache line; the members are private.
+*/
+struct uuid7_gen {
+	UUID7_ALIGNAS(UUID7_CACHE_LINE) uint8_t last[16];
+	uint16_t segment;
+	uint8_t policy:4;
+	uint8_t layout:4;
+	/* with UUID7_ADAPTIVE_SEQ, the nanosecond bits in the sequence */
+	uint8_t seq_bits;
+	clockid_t clockid;
+	/* of uuid7_reset_all, when the generator was last reset */
+	unsigned epoch;
+	struct uuid7_entropy_buf entropy;
+};
+
+/*
+   If entropy is not NULL, random bytes are requested entropy_size
+   at a time, and handed out from the entropy buffer.
+*/
+void uuid7_gen_init(struct uuid7_gen *gen, uint8_t *entropy,
+		    size_t entropy_size);
+uint8_t *uuid7_gen_next(struct uuid7_gen *gen, uint8_t *ubuf);
+uint8_t *uuid7_gen_n(struct uuid7_gen *gen, uint8_t *out, size_t count);
+void uuid7_gen_reset(struct uuid7_gen *gen);
+
+/*
+   A generator reads the clock selected by uuid7_set_clock at the time of
+   uuid7_gen_init, unless given its own. Returns 0, or -1 if the clock
+   can not be read. With UUID7_TSC, only the clock of uuid7_set_clock
+   is derived from the TSC; any other clock is read for each call.
+*/
+int uuid7_gen_clock(struct uuid7_gen *gen, clockid_t clockid);
+
+/*
+   A generator takes the segment of uuid7_set_segment at the time of
+   uuid7_gen_init. This replaces all 16 bits of it, e.g. with a worker id
+   assigned by the caller, thus generators of distinct segments never
+   issue the same UUID.
+*/
+void uuid7_gen_segment(struct uuid7_gen *gen, uint16_t segment);
+
+/*
+   By default, a generator returns NULL if the clock has gone backwards,
+   or if the 256 sequence numbers of a nanosecond are used up.
+   With UUID7_POLICY_BORROW, the generator instead stamps the new UUID
+   with the timestamp and sequence of the last issued UUID plus one,
+   thus every call succeeds and each UUID sorts after the last.
+*/
+#define UUID7_POLICY_FAIL 0
+#define UUID7_POLICY_BORROW 1
+void uuid7_gen_policy(struct uuid7_gen *gen, unsigned policy);
+
+/*
+   By default, a generator stamps the 36 bits of seconds and 24 bits of
+   fraction of the python docs. With UUID7_LAYOUT_RFC9562, it stamps the
+   48 bits of milliseconds of RFC 9562, as does e.g. uuidv7() of
+   PostgreSQL 18, with the 12 bit fraction of the millisecond, and a
+   14 bit counter, for 16384 UUIDs per 1/4096 ms, thus these sort by time
+   with other UUIDs of RFC 9562, but not with UUIDs of the default layout.
+   Changing the layout also resets the generator.
+*/
+#define UUID7_LAYOUT_SECONDS 0
+#define UUID7_LAYOUT_RFC9562 1
+void uuid7_gen_layout(struct uuid7_gen *gen, unsigned layout);
+
+#if !defined(UUID7_NO_THREADS) && !defined(ARDUINO)
+/*
+   A ring of capacity (a power of two) UUIDs, minted ahead of time by a
+   producer thread with uuid7_gen_n, thus uuid7_take is a copy and a
+   compare-and-swap, with no clock read and no request for random bytes,
+   and may be called from any number of threads. When a take leaves
+   low_water or fewer, the producer is woken to refill. The producer also
+   wakes every max_age_ns / 2, and discards UUIDs stamped more than
+   max_age_ns ago, thus a UUID taken is stamped at most about
+   (max_age_ns * 3 / 2) ago, plus any delay in scheduling the producer.
+   If the ring is empty, uuid7_take zeros ubuf and returns NULL.
+   uuid7_ring_start returns NULL if the arguments are not valid, or if
+   memory or the thread can not be had.
+*/
+struct uuid7_ring;
+struct uuid7_ring *uuid7_ring_start(size_t capacity, size_t low_water,
+				    uint64_t max_age_ns);
+uint8_t *uuid7_take(struct uuid7_ring *ring, uint8_t *ubuf);
+void uuid7_ring_stop(struct uuid7_ring *ring);
+#endif
+
+/*
+   Counts of calls to uuid7, uuid7_n, uuid7_gen_next, and uuid7_gen_n,
+   for all threads, unless compiled with -DUUID7_NO_STATS.
+   Each thread adds its counts to the totals every few calls, and upon
+   any failure, thus a snapshot may lag behind the latest calls.
+*/
+struct uuid7_stats {
+	uint64_t calls;
+	uint64_t successes;
+	uint64_t uuids;
+	uint64_t clock_failures;
+	uint64_t random_failures;
+	/* the clock was found behind the last issued UUID */
+	uint64_t backwards;
+	/* rejected, as 256 were issued in a nanosecond */
+	uint64_t seq_exhausted;
+	/* more than 256 were wanted in a nanosecond */
+	uint64_t seq_overflows;
+	/* stamped from the last issued, see UUID7_POLICY_BORROW */
+	uint64_t borrowed;
+	uint64_t max_seq;
+	uint64_t max_backwards_ns;
+	/* with UUID7_TSC, the times the clock was read to re-anchor */
+	uint64_t tsc_anchors;
+	/* the clock minus the time derived from the TSC, at re-anchoring */
+	uint64_t max_tsc_drift_ns;
+	int64_t tsc_drift_ns;
+};
+struct uuid7_stats *uuid7_stats_get(struct uuid7_stats *stats);
+/* adds the counts of the calling thread to the totals now */
+void uuid7_stats_flush(void);
+void uuid7_stats_reset(void);
+
+/*
+   After a large step of the clock backwards, the UUIDs issued since would
+   sort after any issued now, and uuid7 fails (or, with UUID7_NEVER_FAIL,
+   borrows from the last). uuid7_reset_all forgets the last issued UUID
+   of every thread and every generator, without locks: each notices with
+   a relaxed load on its next UUID, thus a thread already in the midst of
+   a UUID may issue one more as if before the reset.
+*/
+void uuid7_reset_all(void);
+
+/*
+   Buffered random bytes are discarded in a child forked with fork(3);
+   a child created some other way (e.g. clone(2)) should call this.
+*/
+void uuid7_forked(void);
+
+/*
+   What reading a clock shows: the resolution from clock_getres, and of
+   UUID7_CLOCK_PROBE_SAMPLES reads back to back, how many returned the
+   same time as the read before, and the smallest step between reads.
+   The lowest tick_bits of the nanoseconds do not change with the clock,
+   thus of the 6 bits of hiseq, which hold the lowest bits, hiseq_bits
+   is how many do.
+*/
+#ifndef UUID7_CLOCK_PROBE_SAMPLES
+#define UUID7_CLOCK_PROBE_SAMPLES 1000
+#endif
+struct uuid7_clock_info {
+	clockid_t clockid;
+	unsigned hiseq_bits;
+	unsigned tick_bits;
+	uint64_t resolution_ns;
+	uint64_t samples;
+	uint64_t duplicates;
+	uint64_t step_ns;
+};
+int uuid7_clock_probe(clockid_t clockid, struct uuid7_clock_info *info);
+
+/*
+   Selects the clock for uuid7, uuid7_n, and new generators, e.g. the
+   clockid of an opened /dev/ptp0. Returns 0, or -1 if the clock can not
+   be read, leaving the clock unchanged. Call before generating UUIDs,
+   not while other threads are generating. uuid7_get_clock returns the
+   clock in use, and if info is not NULL, what a probe of it showed.
+*/
+int uuid7_set_clock(clockid_t clockid);
+clockid_t uuid7_get_clock(struct uuid7_clock_info *info);
+
+/*
+   By default the segment, bytes 10-11, tells apart the threads (or CPU
+   slots, or generators) of a process, or is random where there is one
+   stream. uuid7_set_segment fixes the high bits of every segment to the
+   low bits of node, e.g. 9 bits for up to 512 hosts, leaving 16 - bits
+   to tell threads apart as before; with 16 bits, the whole segment is
+   node. In the mutex, atomic, or no-threads builds, a process is a single
+   ordered stream, thus UUIDs of distinct nodes, each a single process,
+   are unique by construction. Returns 0, or -1 if bits is over 16, or
+   node does not fit in bits. Zero bits unsets. Call before generating
+   UUIDs, as with uuid7_set_clock.
+
+   uuid7_set_segment_env reads UUID7_SEGMENT, as "node" or "node/bits",
+   of decimal, or hex with "0x". Returns 1 if set, 0 if UUID7_SEGMENT is
+   unset or empty, or -1 if it is not valid, leaving the segment as is.
+*/
+int uuid7_set_segment(uint16_t node, unsigned bits);
+#ifndef ARDUINO
+int uuid7_set_segment_env(void);
+#endif
+
 struct uuid7 {
 	uint64_t seconds:36;
 	uint16_t hifrac:12;
@@ -31,7 +370,140 @@ struct uuid7 {
 	uint16_t segment:16;
 	uint32_t rand:32;
 };
+
+/*
+   Packs the timestamp, segment, and random bytes in to ubuf, with a
+   sequence of zero. Nothing is compared with the last issued UUID.
+   uuid7_parts decodes either layout, as told by the variant; of the
+   RFC 9562 layout, the hiseq and loseq are the counter, and the time is
+   within the 1/4096 ms.
+*/
+#ifndef UUID7_HEADER_ONLY
+uint8_t *uuid7_pack(uint8_t *ubuf, struct timespec ts, uint16_t segment,
+		    uint32_t random_bytes);
+uint8_t *uuid7_pack_rfc9562(uint8_t *ubuf, struct timespec ts,
+			    uint16_t segment, uint32_t random_bytes);
 struct uuid7 *uuid7_parts(struct uuid7 *u, const uint8_t *bytes);
+#endif
+
+/*
+   A UUID as two numbers, the first 8 bytes most significant first as hi,
+   the last 8 as lo, thus UUIDs compare as their values compare, with two
+   integer compares rather than a memcmp; e.g. as the key of a map.
+   uuid7_compare has the signature of a qsort comparison of 16 byte IDs,
+   and returns less than, equal to, or greater than zero, as memcmp.
+*/
+struct uuid7_u128 {
+	uint64_t hi;
+	uint64_t lo;
+};
+#ifndef UUID7_HEADER_ONLY
+struct uuid7_u128 uuid7_to_u128(const uint8_t *bytes);
+uint8_t *uuid7_from_u128(uint8_t *ubuf, struct uuid7_u128 v);
+int uuid7_u128_compare(struct uuid7_u128 a, struct uuid7_u128 b);
+int uuid7_compare(const void *a, const void *b);
+#endif
+
+/*
+   The time of the stamp of a UUID of either layout, in nanoseconds since
+   the epoch, without a struct uuid7. Of the RFC 9562 layout, the first
+   nanosecond of the 1/4096 ms. The UUID is not checked.
+*/
+#ifndef UUID7_HEADER_ONLY
+uint64_t uuid7_timestamp_ns(const uint8_t *bytes);
+#endif
+
+/*
+   Decodes count UUIDs in to columns, one array for each field; a NULL
+   array is skipped. The seq is the loseq, or of the RFC 9562 layout,
+   the 14 bit counter. If any ID is not a version 7 UUID, its fields are
+   zeroed, and NULL is returned once all are decoded.
+*/
+struct uuid7_columns {
+	uint64_t *unix_ns;
+	uint16_t *segment;
+	uint16_t *seq;
+	uint32_t *rand;
+};
+struct uuid7_columns *uuid7_parts_n(struct uuid7_columns *columns,
+				    const uint8_t *ids, size_t count);
+
+/*
+   A 64 bit hash of a UUID, for hash tables: the first 8 bytes, of the
+   time, are multiplied by an odd constant and xored over the last 8, of
+   the sequence, segment, and random, then mixed by the multiply-xorshift
+   finalizer of MurmurHash3. Thus each bit of the hash depends on each bit
+   of the sequence, segment, and random, and on the low bits of the time,
+   and IDs of a batch, which differ only in those, spread over the buckets
+   of an open addressing table, by low or high bits, as random numbers.
+   It is not a keyed hash: where an adversary chooses the keys, use one
+   such as SipHash. uuid7_hash64_n writes the hashes of count IDs to out.
+*/
+#ifndef UUID7_HEADER_ONLY
+uint64_t uuid7_hash64(const uint8_t *bytes);
+#endif
+uint64_t *uuid7_hash64_n(uint64_t *out, const uint8_t *ids, size_t count);
+
+/* compilers turn the memcmp of 16 bytes in to two 8 byte compares */
+static inline int uuid7_equal(const uint8_t *a, const uint8_t *b)
+{
+	return memcmp(a, b, 16) == 0;
+}
+
+/*
+   The lowest and highest UUIDs which may be stamped with the time ts, of
+   the layout UUID7_LAYOUT_SECONDS or UUID7_LAYOUT_RFC9562 (within the
+   1/4096 ms of ts), thus a range of times is a range of keys.
+*/
+#ifndef UUID7_HEADER_ONLY
+uint8_t *uuid7_min_for_time(uint8_t *ubuf, struct timespec ts,
+			    unsigned layout);
+uint8_t *uuid7_max_for_time(uint8_t *ubuf, struct timespec ts,
+			    unsigned layout);
+#endif
+
+/*
+   Of count sorted ids, uuid7_lower_bound returns the index of the first
+   which is not less than key, uuid7_upper_bound of the first which is
+   greater than key, or count if there is none. uuid7_time_range returns
+   how many were stamped from begin through end, inclusive, and sets
+   first to the index of the first of them.
+*/
+size_t uuid7_lower_bound(const uint8_t *ids, size_t count,
+			 const uint8_t *key);
+size_t uuid7_upper_bound(const uint8_t *ids, size_t count,
+			 const uint8_t *key);
+size_t uuid7_time_range(const uint8_t *ids, size_t count,
+			struct timespec begin, struct timespec end,
+			unsigned layout, size_t *first);
+
+/*
+   Sorts count 16 byte IDs, in the order of uuid7_compare, with a radix
+   sort of the 80 bit prefix of time and sequence. An array which is
+   already sorted is only read. If memory for a copy can not be had,
+   qsort is used instead. uuid7_sort_parallel sorts a part in each of
+   up to UUID7_SORT_MAX_THREADS threads, then merges the parts.
+*/
+#ifndef UUID7_SORT_MAX_THREADS
+#define UUID7_SORT_MAX_THREADS 64
+#endif
+uint8_t *uuid7_sort(uint8_t *ids, size_t count);
+uint8_t *uuid7_sort_parallel(uint8_t *ids, size_t count, size_t threads);
+
+/*
+   Merges num_runs sorted runs, e.g. the batches of each thread, of
+   lens[i] IDs at runs[i], in to out, which must have room for them all.
+   Returns NULL, with out zeroed, if memory can not be had.
+*/
+uint8_t *uuid7_merge(uint8_t *out, const uint8_t *const *runs,
+		     const size_t *lens, size_t num_runs);
+
+/* of sorted ids, removes the repeats, returning the count kept */
+size_t uuid7_dedupe(uint8_t *ids, size_t count);
+
+#if defined(UUID7_HEADER_ONLY) || defined(UUID7_IMPLEMENTATION)
+#include "uuid7-inline.h"
+#endif
 
 extern const uint8_t uuid7_version;
 extern const uint8_t uuid7_variant;
@@ -0,0 +1,262 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/* Copyright (C) 2024 Eric Herman <eric@freesa.org> */
+
+#ifndef UUID7_HPP
+#define UUID7_HPP 1
+
+/*
+   A C++17 value type over the 16 bytes of uuid7.h: trivially copyable,
+   16 byte aligned, and never allocating, but for to_string. With C++20,
+   ids compare with <=>, and with <format>, std::format formats them.
+   Parsing is constexpr, thus "..."_uuid7 literals are checked, and made,
+   by the compiler; at run time it uses uuid7_from_string. The namespace
+   is libuuid7, as uuid7 is the name of the C function.
+*/
+
+#include "uuid7.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+#include <compare>
+#endif
+#if __has_include(<format>)
+#include <format>
+#endif
+
+namespace libuuid7 {
+
+struct alignas(16) id {
+	std::array<uint8_t, 16> bytes;
+
+	/* each the first 8 and last 8 bytes, most significant first */
+	constexpr uint64_t hi() const noexcept {
+		return word(0);
+	}
+	constexpr uint64_t lo() const noexcept {
+		return word(8);
+	}
+
+	const uint8_t *data() const noexcept {
+		return bytes.data();
+	}
+	uint8_t *data() noexcept {
+		return bytes.data();
+	}
+
+	static id from_bytes(const uint8_t *src) noexcept {
+		id u {};
+		std::memcpy(u.bytes.data(), src, 16);
+		return u;
+	}
+
+	/* a new UUID of the global state, or nothing as uuid7 returns NULL */
+	static std::optional<id> generate() noexcept {
+		id u {};
+		if (!::uuid7(u.bytes.data())) {
+			return std::nullopt;
+		}
+		return u;
+	}
+
+	static std::optional<id> generate(struct uuid7_gen &gen) noexcept {
+		id u {};
+		if (!::uuid7_gen_next(&gen, u.bytes.data())) {
+			return std::nullopt;
+		}
+		return u;
+	}
+
+	/* 36 characters of 8-4-4-4-12 or 32 bare hex, as uuid7_from_string */
+	static constexpr std::optional<id> parse(std::string_view str) noexcept;
+
+	/* writes the 36 characters, without a NUL, returns dst + 36 */
+	char *to_chars(char *dst) const noexcept {
+		::uuid7_to_string_n(dst, 36, bytes.data(), 1, 36);
+		return dst + 36;
+	}
+
+	std::string to_string() const {
+		std::string str(36, '\0');
+		to_chars(&str[0]);
+		return str;
+	}
+
+	uint64_t timestamp_ns() const noexcept {
+		return ::uuid7_timestamp_ns(bytes.data());
+	}
+
+	constexpr int compare(const id &other) const noexcept {
+		uint64_t a = hi();
+		uint64_t b = other.hi();
+		if (a == b) {
+			a = lo();
+			b = other.lo();
+		}
+		return (a > b) - (a < b);
+	}
+
+	friend constexpr bool operator==(const id &a, const id &b) noexcept {
+		return a.hi() == b.hi() && a.lo() == b.lo();
+	}
+	friend constexpr bool operator!=(const id &a, const id &b) noexcept {
+		return !(a == b);
+	}
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+	friend constexpr std::strong_ordering
+	operator<=>(const id &a, const id &b) noexcept {
+		return a.compare(b) <=> 0;
+	}
+#else
+	friend constexpr bool operator<(const id &a, const id &b) noexcept {
+		return a.compare(b) < 0;
+	}
+	friend constexpr bool operator>(const id &a, const id &b) noexcept {
+		return a.compare(b) > 0;
+	}
+	friend constexpr bool operator<=(const id &a, const id &b) noexcept {
+		return a.compare(b) <= 0;
+	}
+	friend constexpr bool operator>=(const id &a, const id &b) noexcept {
+		return a.compare(b) >= 0;
+	}
+#endif
+
+private:
+	constexpr uint64_t word(size_t at) const noexcept {
+		uint64_t v = 0;
+		for (size_t i = 0; i < 8; ++i) {
+			v = (v << 8) | bytes[at + i];
+		}
+		return v;
+	}
+};
+
+static_assert(sizeof(id) == 16, "an id is the 16 bytes");
+static_assert(alignof(id) == 16, "an id is 16 byte aligned");
+static_assert(std::is_trivially_copyable<id>::value,
+	      "an id copies as its bytes");
+
+namespace detail {
+
+constexpr int unhex(char c) noexcept {
+	return (c >= '0' && c <= '9') ? (c - '0')
+	    : (c >= 'a' && c <= 'f') ? (c - 'a' + 10)
+	    : (c >= 'A' && c <= 'F') ? (c - 'A' + 10)
+	    : -1;
+}
+
+constexpr std::optional<id> parse(std::string_view str) noexcept {
+	bool dashed = str.size() == 36;
+	if (!dashed && str.size() != 32) {
+		return std::nullopt;
+	}
+	if (dashed && (str[8] != '-' || str[13] != '-' || str[18] != '-'
+		       || str[23] != '-')) {
+		return std::nullopt;
+	}
+	id u {};
+	size_t pos = 0;
+	for (size_t i = 0; i < 16; ++i) {
+		if (dashed && (pos == 8 || pos == 13 || pos == 18
+			       || pos == 23)) {
+			++pos;
+		}
+		int high = unhex(str[pos]);
+		int low = unhex(str[pos + 1]);
+		if (high < 0 || low < 0) {
+			return std::nullopt;
+		}
+		u.bytes[i] = static_cast<uint8_t>((high << 4) | low);
+		pos += 2;
+	}
+	unsigned ver = u.bytes[6] >> 4;
+	unsigned var = u.bytes[8] >> 6;
+	if (ver != UUID7_VERSION
+	    || (var != UUID7_VARIANT && var != UUID7_VARIANT_RFC9562)) {
+		return std::nullopt;
+	}
+	return u;
+}
+
+} /* namespace detail */
+
+constexpr std::optional<id> id::parse(std::string_view str) noexcept {
+#if defined(__cpp_lib_is_constant_evaluated)
+	if (!std::is_constant_evaluated()) {
+		id u {};
+		if (!::uuid7_from_string(u.bytes.data(), str.data(),
+					 str.size())) {
+			return std::nullopt;
+		}
+		return u;
+	}
+#endif
+	return detail::parse(str);
+}
+
+inline std::ostream &operator<<(std::ostream &os, const id &u) {
+	char buf[36];
+	return os.write(buf, u.to_chars(buf) - buf);
+}
+
+namespace literals {
+
+/* an invalid literal is not a constant, thus does not compile */
+#if defined(__cpp_consteval)
+consteval
+#else
+constexpr
+#endif
+id operator""_uuid7(const char *str, size_t len) {
+	std::optional<id> u = detail::parse(std::string_view(str, len));
+	if (!u) {
+		throw "not a version 7 UUID";
+	}
+	return *u;
+}
+
+} /* namespace literals */
+
+} /* namespace libuuid7 */
+
+namespace std {
+/* of uuid7_hash64, thus well spread by the low bits, or the high */
+template <> struct hash<libuuid7::id> {
+	size_t operator()(const libuuid7::id &u) const noexcept {
+		return static_cast<size_t>(::uuid7_hash64(u.data()));
+	}
+};
+
+#if defined(__cpp_lib_format)
+/* "{}" formats as 8-4-4-4-12, in to the output, with uuid7_to_string_n */
+template <> struct formatter<libuuid7::id, char> {
+	constexpr auto parse(std::format_parse_context &ctx) {
+		auto it = ctx.begin();
+		if (it != ctx.end() && *it != '}') {
+			throw std::format_error("no format spec of an id");
+		}
+		return it;
+	}
+
+	template <typename FormatContext>
+	auto format(const libuuid7::id &u, FormatContext &ctx) const {
+		char buf[36];
+		u.to_chars(buf);
+		return std::copy(buf, buf + 36, ctx.out());
+	}
+};
+#endif
+} /* namespace std */
+
+#endif /* UUID7_HPP */